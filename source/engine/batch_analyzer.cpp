@@ -0,0 +1,166 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+#include "batch_analyzer.hpp"
+
+namespace {
+  double SecondsSince (std::chrono::steady_clock::time_point time) {
+    return std::chrono::duration <double> (std::chrono::steady_clock::now () - time).count ();
+  }
+}
+
+
+BatchAnalyzer::BatchAnalyzer (Gtp::ReplWithGogui& gtp,
+                              const Gammas& gammas,
+                              Engine& engine)
+  : gammas (gammas), engine (engine)
+{
+  gtp.Register ("batch_analyze", this, &BatchAnalyzer::CBatchAnalyze);
+}
+
+
+uint BatchAnalyzer::Run (istream& input, ostream& output,
+                         uint playouts, uint thread_count)
+{
+  in = &input;
+  out = &output;
+  read_count = 0;
+  write_count = 0;
+  pending.clear ();
+  start_time = std::chrono::steady_clock::now ();
+  report_time = start_time;
+
+  vector <thread> threads;
+  rep (ii, thread_count) {
+    threads.push_back (thread (&BatchAnalyzer::Worker, this, playouts));
+  }
+  rep (ii, threads.size ()) threads [ii].join ();
+
+  CHECK (pending.empty ());
+  out->flush ();
+  return write_count;
+}
+
+
+void BatchAnalyzer::Worker (uint playouts) {
+  Engine* worker = new Engine (gammas);
+  worker->GetParam () = engine.GetParam ();
+  worker->SetQuiet (true);
+
+  uint index;
+  string position;
+  while (ReadPosition (&index, &position)) {
+    WriteResult (index, Analyze (*worker, position, playouts));
+  }
+
+  delete worker;
+}
+
+
+string BatchAnalyzer::Analyze (Engine& worker, const string& position, uint playouts) {
+  istringstream line (position);
+  string id;
+  line >> id;
+  vector <Move> moves;
+  while (true) {
+    Move m = Move::OfGtpStream (line);
+    if (!line) break;
+    moves.push_back (m);
+  }
+
+  ostringstream result;
+  result << id << " ";
+
+  CHECK (worker.Reset (board_size));
+  uint legal_count = worker.SetPosition (moves);
+  if (legal_count < moves.size ()) {
+    result << "? illegal move " << legal_count + 1;
+    return result.str ();
+  }
+
+  worker.DoNPlayouts (playouts);
+  double mean;
+  Move best = worker.MostExploredMove (&mean);
+
+  NatMap <Vertex, double> ownership;
+  worker.GetInfluence (Engine::MctsTerritory, ownership);
+
+  result << best.GetVertex ().ToGtpString () << " "
+         << fixed << setprecision (3) << (mean + 1.0) / 2.0 << " ";
+  rep (row, board_size) {
+    rep (col, board_size) {
+      double o = ownership [Vertex::OfCoords (row, col)];
+      result << char ('0' + int ((o + 1.0) * 4.5 + 0.5));
+    }
+  }
+  return result.str ();
+}
+
+
+bool BatchAnalyzer::ReadPosition (uint* index, string* position) {
+  lock_guard <std::mutex> lock (mutex);
+  while (getline (*in, *position)) {
+    istringstream line (*position);
+    string id;
+    if (!(line >> id) || id [0] == '#') continue;
+    *index = read_count;
+    read_count += 1;
+    return true;
+  }
+  return false;
+}
+
+
+void BatchAnalyzer::WriteResult (uint index, const string& result) {
+  lock_guard <std::mutex> lock (mutex);
+  pending [index] = result;
+  while (pending.size () > 0 && pending.begin()->first == write_count) {
+    *out << pending.begin()->second << "\n";
+    pending.erase (pending.begin());
+    write_count += 1;
+  }
+
+  if (SecondsSince (report_time) >= 1.0) {
+    report_time = std::chrono::steady_clock::now ();
+    LOG (Log::Info, "batch_analyze: " << write_count << " positions, "
+         << write_count / SecondsSince (start_time) << " positions/s");
+  }
+}
+
+
+// Usage: batch_analyze in_file out_file [playouts] [threads]
+// "-" reads from stdin. 0 threads means one per core.
+void BatchAnalyzer::CBatchAnalyze (Gtp::Io& io) {
+  string in_name = io.Read <string> ();
+  string out_name = io.Read <string> ();
+  uint playouts = io.Read <uint> (engine.GetParam ().genmove_playouts);
+  uint thread_count = io.Read <uint> (0);
+  io.CheckEmpty ();
+
+  if (thread_count == 0) thread_count = max (thread::hardware_concurrency (), 1u);
+
+  ifstream in_file;
+  if (in_name != "-") {
+    in_file.open (in_name.c_str ());
+    if (!in_file) {
+      io.SetError ("can't open: " + in_name);
+      return;
+    }
+  }
+  ofstream out_file (out_name.c_str ());
+  if (!out_file) {
+    io.SetError ("can't open: " + out_name);
+    return;
+  }
+
+  uint count = Run (in_name == "-" ? cin : in_file, out_file, playouts, thread_count);
+  double seconds = SecondsSince (start_time);
+  io.out << count << " positions, " << thread_count << " threads, "
+         << seconds << " s, " << count / seconds << " positions/s";
+}
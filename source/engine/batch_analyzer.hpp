@@ -0,0 +1,59 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#ifndef BATCH_ANALYZER_H_
+#define BATCH_ANALYZER_H_
+
+#include <chrono>
+#include <istream>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+#include "gtp_gogui.hpp"
+#include "engine.hpp"
+
+// Offline analysis of many positions on all cores.
+//
+// Every input line is "<id> [color vertex]*", empty lines and lines
+// starting with '#' are skipped. Every position gets a fixed playout budget
+// on one of the per-thread engines. Output lines come in input order:
+//
+//   <id> <best vertex> <win rate> <ownership>
+//
+// Win rate is for the player to move. Ownership has one character per
+// vertex, row by row from the top: '0' is certainly white, '9' certainly
+// black. A position with an illegal move gives "<id> ? illegal move <n>".
+class BatchAnalyzer {
+public:
+  // New engines copy their settings from the given one.
+  BatchAnalyzer (Gtp::ReplWithGogui& gtp, const Gammas& gammas, Engine& engine);
+
+  // Analyzes all positions from in. Returns the number of positions.
+  uint Run (std::istream& input, std::ostream& output,
+            uint playouts, uint thread_count);
+
+private:
+  void Worker (uint playouts);
+  std::string Analyze (Engine& worker, const std::string& position, uint playouts);
+  bool ReadPosition (uint* index, std::string* position);
+  void WriteResult (uint index, const std::string& result);
+  void CBatchAnalyze (Gtp::Io& io);
+
+  const Gammas& gammas;
+  Engine& engine;
+
+  // State of the current Run, guarded by mutex.
+  std::mutex mutex;
+  std::istream* in;
+  std::ostream* out;
+  uint read_count;
+  uint write_count;
+  std::map <uint, std::string> pending;
+  std::chrono::steady_clock::time_point start_time;
+  std::chrono::steady_clock::time_point report_time;
+};
+
+#endif
@@ -2,21 +2,51 @@
 // Copyright 2006 and onwards, Lukasz Lew
 //
 
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <thread>
+
 #include "engine.hpp"
+#include "playout_pool.hpp"
+#include "pool_allocator.hpp"
+
+namespace {
+  // A node of MctsNode::ChildrenList is the MctsNode and two links, kept
+  // in a pool block.
+  const size_t kListNodeSize = sizeof (MctsNode) + 2 * sizeof (void*);
+#ifdef __GLIBCXX__
+  static_assert (sizeof (std::_List_node <MctsNode>) == kListNodeSize,
+                 "unexpected std::list node layout");
+#endif
+}
 
-Engine::Engine () :
+Engine::Engine (const Gammas& gammas) :
+  time_control (param),
+  gammas (gammas),
+  playout_pool (NULL),
+  quiet (false),
   random (TimeSeed()),
-  root (Player::White(), Vertex::Any (), 0.0),
-  sampler (playout_board, gammas)
+  root (Player::White(), Vertex::Any (), 0.0, param),
+  sampler (playout_board, gammas),
+  trace (param)
 {
+  session_playouts = 0;
+  session_seconds = 0.0;
+  session_nodes = 0;
+  last_playouts = 0;
+  last_seconds = 0.0;
+  searching = false;
+  ownership_skip = 0;
   CHECK (Reset (board_size));
 }
 
 
 bool Engine::Reset (uint board_size) {
   base_board.Clear ();
-  root.Reset ();
-  base_node = &root; // easy SyncRoot
+  ResetTree ();
+  ResetOwnership ();
+  UpdateLiveStats ();
   return board_size == ::board_size;
 }
 
@@ -27,22 +57,48 @@ void Engine::SetKomi (float komi) {
 
 
 bool Engine::Play (Move move) {
+  bool ok = PlayKeepingOwnership (move);
+  if (ok) ResetOwnership ();
+  return ok;
+}
+
+
+bool Engine::PlayKeepingOwnership (Move move) {
   CHECK (move.IsValid ());
   bool ok = base_board.IsReallyLegal (move);
   if (ok) {
     base_board.PlayLegal (move);
     SyncRoot ();
-    base_board.Dump();
+    if (!quiet) LogBoard ();
   }
   return ok;
 }
 
 
+uint Engine::SetPosition (const vector<Move>& moves) {
+  vector<Move> old_moves = base_board.Moves ();
+  uint legal_count = base_board.Replay (moves);
+  if (legal_count < moves.size ()) {
+    CHECK (base_board.Replay (old_moves) == old_moves.size ());
+    return legal_count;
+  }
+  ResetTree ();
+  SyncRoot ();
+  ResetOwnership ();
+  if (!quiet) LogBoard ();
+  return legal_count;
+}
+
+
 Move Engine::Genmove (Player player) {
+  // Only this search's samples, not those of earlier genmoves.
+  ResetOwnership ();
   base_board.SetActPlayer (player);
   Move move = ChooseBestMove ();
   if (move.IsValid ()) {
-    CHECK (Play (move));
+    // The search's ownership stays: its playouts mostly continue
+    // with this move.
+    CHECK (PlayKeepingOwnership (move));
   }
   return move;
 }
@@ -52,6 +108,7 @@ bool Engine::Undo () {
   bool ok = base_board.Undo ();
   if (ok) {
     SyncRoot ();
+    ResetOwnership ();
   }
   return ok;
 }
@@ -67,11 +124,114 @@ void Engine::DoPlayoutMove () {
 }
 
 
+const SearchProfile& Engine::GetSearchProfile () const {
+  return profile;
+}
+
+
+string Engine::StatsToString () const {
+  ostringstream out;
+  out << fixed << setprecision (1)
+      << "playouts_last " << last_playouts << endl
+      << "playouts_per_second_last "
+      << (last_seconds > 0.0 ? last_playouts / last_seconds : 0.0) << endl
+      << "playouts_session " << session_playouts << endl
+      << "playouts_per_second_session "
+      << (session_seconds > 0.0 ? session_playouts / session_seconds : 0.0) << endl
+      << "nodes_live " << live_nodes << endl
+      << "tree_bytes " << live_nodes * BlockPool <kListNodeSize>::BlockBytes () << endl
+      << "nodes_created_last " << profile.NodeCount () << endl
+      << "nodes_created_session " << session_nodes << endl
+      // Shared by all engines of the process, never shrinks.
+      << "pool_bytes " << BlockPoolBytes () << endl
+      << "tree_depth_max " << profile.MaxDepth () << endl
+      << "tree_depth_mean " << profile.MeanDepth () << endl
+      << "expansions " << profile.ExpansionCount () << endl;
+  if (searching) {
+    out << "search_playouts " << profile.PlayoutCount () << endl
+        << "search_seconds "
+        << chrono::duration <double> (chrono::steady_clock::now () - search_begin).count ()
+        << endl;
+  }
+
+  // Most visited moves at the root.
+  Player pl = base_board.ActPlayer ();
+  vector <pair <float, const MctsNode*> > visits;
+  float visit_sum = 0.0;
+  for (MctsNode::ChildrenList::const_iterator child = base_node->children.begin();
+       child != base_node->children.end();
+       ++child)
+  {
+    if (child->player != pl) continue;
+    visits.push_back (make_pair (child->stat.update_count (), &*child));
+    visit_sum += child->stat.update_count ();
+  }
+  sort (visits.rbegin (), visits.rend ());
+  out << "root_visits";
+  rep (ii, min <size_t> (visits.size (), 10)) {
+    const MctsNode& node = *visits [ii].second;
+    out << " " << node.v.ToGtpString () << ":" << setprecision (0) << visits [ii].first
+        << "(" << setprecision (1) << 100.0 * visits [ii].first / visit_sum << "%,"
+        << setprecision (3) << node.SubjectiveMean () << ")";
+  }
+  out << endl;
+
+  // Principal variation by visits, while nodes have real visits.
+  out << "pv";
+  const MctsNode* node = base_node;
+  rep (ii, 20) {
+    if (!node->has_all_legal_children [pl]) break;
+    const MctsNode& child = node->MostExploredChild (pl);
+    if (child.stat.update_count () <= param.prior_update_count) break;
+    out << " " << child.GetMove ().ToGtpString ();
+    node = &child;
+    pl = pl.Other ();
+  }
+  return out.str ();
+}
+
+
+string Engine::LiveStatsToString () const {
+  std::lock_guard <std::mutex> lock (live_stats_mutex);
+  return live_stats;
+}
+
+
+void Engine::UpdateLiveStats () {
+  string stats = StatsToString ();
+  std::lock_guard <std::mutex> lock (live_stats_mutex);
+  live_stats.swap (stats);
+  live_stats_time = chrono::steady_clock::now ();
+}
+
+
 const Board& Engine::GetBoard () const {
   return base_board;
 }
 
 
+Param& Engine::GetParam () {
+  return param;
+}
+
+
+void Engine::SetPlayoutPool (PlayoutPool* pool) {
+  playout_pool = pool;
+}
+
+
+void Engine::LogBoard () const {
+  LOG (Log::Debug,
+       base_board.ToAsciiArt (base_board.LastVertex ()) <<
+       base_board.ActPlayer ().ToGtpString () << " to play");
+}
+
+
+void Engine::SetQuiet (bool new_quiet) {
+  quiet = new_quiet;
+}
+
+
 void Engine::GetInfluence (InfluenceType type, 
                            NatMap <Vertex,double>& influence)
 {
@@ -125,7 +285,7 @@ void Engine::GetInfluence (InfluenceType type,
           influence [v] = node->bias;
           break;
         case MctsPolicyMix:
-          influence [v] = node->SubjectiveRaveValue (base_board.ActPlayer(), log_val);
+          influence [v] = node->SubjectiveRaveValue (base_board.ActPlayer(), log_val, param);
           break;
         case SamplerMoveProb:
         case PatternGammas:
@@ -143,36 +303,138 @@ void Engine::GetInfluence (InfluenceType type,
   }
 }
 
-void Engine::EstimateTerritory (NatMap<Vertex, double>& influence, bool use_tree) {
-  const uint n = 200;
+void Engine::Ownership::Reset () {
+  sum.SetAllToZero ();
+  count = 0;
+}
+
+
+void Engine::Ownership::Add (const RawBoard& board) {
+  ForEachNat (Vertex, v) {
+    Color c = board.ColorAt (v);
+    if (c.IsPlayer ()) {
+      sum [v] += c.ToPlayer().ToScore();
+    } else if (c == Color::Empty ()) {
+      sum [v] += board.EyeScore (v);
+    }
+  }
+  count += 1;
+}
 
-  influence.SetAll (0.0);
+
+void Engine::Ownership::Merge (const Ownership& other) {
+  ForEachNat (Vertex, v) sum [v] += other.sum [v];
+  count += other.count;
+}
+
+
+void Engine::EstimateTerritory (NatMap<Vertex, double>& influence, bool use_tree) {
+  const Ownership& o = ownership [use_tree];
+  if (o.count < param.ownership_playouts) {
+    SampleOwnership (param.ownership_playouts - o.count, use_tree);
+  }
 
   ForEachNat (Vertex, v) {
-    if (!v.IsOnBoard()) influence [v] = qnan;
+    if (!v.IsOnBoard()) {
+      influence [v] = qnan;
+    } else {
+      influence [v] = o.count > 0 ? double (o.sum [v]) / o.count : 0.0;
+    }
+  }
+}
+
+
+// Extra playouts for the ownership only, the tree is neither
+// expanded nor updated so threads can share it.
+// Runs on the playout pool if there is one.
+void Engine::SampleOwnership (uint n, bool use_tree) {
+  uint thread_count = param.ownership_threads;
+  if (thread_count == 0) {
+    thread_count = playout_pool != NULL ?
+      playout_pool->ThreadCount () :
+      std::thread::hardware_concurrency ();
+  }
+  thread_count = max (1u, min (thread_count, n));
+
+  vector <OwnershipPart> parts (thread_count);
+  rep (ii, thread_count) {
+    parts [ii].n = n / thread_count + (ii < n % thread_count ? 1 : 0);
+    parts [ii].seed = random.GetNextUint ();
+  }
+
+  if (playout_pool != NULL) {
+    playout_pool->Run (thread_count, bind (&Engine::SampleOwnershipPart, this,
+                                           use_tree, &parts, placeholders::_1));
+  } else {
+    vector <std::thread> threads;
+    rep (ii, thread_count) {
+      threads.push_back (std::thread (&Engine::SampleOwnershipPart, this,
+                                      use_tree, &parts, ii));
+    }
+    rep (ii, thread_count) threads [ii].join ();
   }
+  rep (ii, thread_count) ownership [use_tree].Merge (parts [ii].result);
+}
+
+
+void Engine::SampleOwnershipPart (bool use_tree, vector <OwnershipPart>* parts,
+                                  uint ii)
+{
+  OwnershipPart& part = (*parts) [ii];
+  SampleOwnershipThread (part.n, use_tree, part.seed, &part.result);
+}
+
+
+void Engine::SampleOwnershipThread (uint n, bool use_tree, uint seed,
+                                    Ownership* result)
+{
+  RawBoard board;
+  Sampler sampler (board, gammas);
+  FastRandom random (seed);
+  result->Reset ();
 
   rep (ii, n) {
-    DoOnePlayout (use_tree, false);
-    ForEachNat (Vertex, v) {
-      Color c = playout_board.ColorAt (v);
-      if (c == Color::OffBoard()) continue;
-      if (c.IsPlayer ()) {
-        influence [v] += c.ToPlayer().ToScore() / double (n);
+    board.Load (base_board);
+    sampler.NewPlayout ();
+    MctsNode* node = use_tree ? base_node : NULL;
+
+    while (!board.BothPlayerPass()) {
+      if (board.MoveCount() >= 3*Board::kArea) break;
+      Player pl = board.ActPlayer ();
+      Vertex v;
+      if (node != NULL && node->has_all_legal_children [pl]) {
+        node = &node->BestRaveChild (pl, param);
+        v = node->v;
       } else {
-        CHECK (c == Color::Empty ());
-        influence [v] += playout_board.EyeScore (v) / double (n);
+        node = NULL;
+        v = sampler.SampleMove (random);
       }
+      board.PlayLegal (pl, v);
+      sampler.MovePlayed ();
     }
+    if (board.BothPlayerPass()) result->Add (board);
   }
 }
 
 
+void Engine::ResetTree () {
+  root.Reset (param);
+  base_node = &root; // easy SyncRoot
+  live_nodes = 1;
+}
+
+
+void Engine::ResetOwnership () {
+  ownership [false].Reset ();
+  ownership [true].Reset ();
+}
+
+
 std::string Engine::GetStringForVertex (Vertex v) {
   Move m = Move (base_board.ActPlayer (), v);
   MctsNode* node = base_node->FindChild (m);
   if (node != NULL) {
-    return node->GuiString ();
+    return node->GuiString (param);
   } else {
     return "";
   }
@@ -183,18 +445,50 @@ Move Engine::ChooseBestMove () {
   // TODO Garbage collection of old tree here !
   Player player = base_board.ActPlayer ();
   int playouts = time_control.PlayoutCount (player);
-  DoNPlayouts (playouts);
+  profile.Reset ();
+  searching = true;
+  search_begin = chrono::steady_clock::now ();
+  // Chunks let the snapshot be refreshed outside of the playout loop.
+  for (int done = 0; done < playouts; done += kLiveStatsChunk) {
+    DoNPlayouts (min (playouts - done, int (kLiveStatsChunk)));
+    if (chrono::steady_clock::now () - live_stats_time > chrono::seconds (1)) {
+      UpdateLiveStats ();
+    }
+  }
+  double seconds =
+    chrono::duration <double> (chrono::steady_clock::now () - search_begin).count ();
+  searching = false;
+  profile.SetSeconds (seconds);
+  last_playouts = playouts;
+  last_seconds = seconds;
+  session_playouts += playouts;
+  session_seconds += seconds;
+  session_nodes += profile.NodeCount ();
+  UpdateLiveStats ();
 
   const MctsNode& best_node = base_node->MostExploredChild (player);
 
   return
-    best_node.SubjectiveMean() < Param::resign_mean ?
+    best_node.SubjectiveMean() < param.resign_mean ?
     Move::Invalid() :
     Move (player, best_node.v);
 }
 
 
+Move Engine::MostExploredMove (double* mean) {
+  Player player = base_board.ActPlayer ();
+  const MctsNode& best_node = base_node->MostExploredChild (player);
+  *mean = best_node.SubjectiveMean ();
+  return Move (player, best_node.v);
+}
+
+
 void Engine::DoNPlayouts (uint n) {
+  TRACE_SPAN ("DoNPlayouts");
+  if (playout_pool != NULL) {
+    playout_pool->DoNPlayouts (*this, n);
+    return;
+  }
   rep (ii, n) {
     DoOnePlayout (true, true);
   }
@@ -202,6 +496,7 @@ void Engine::DoNPlayouts (uint n) {
 
 
 void Engine::SyncRoot () {
+  TRACE_SPAN ("SyncRoot");
   // TODO replace this by FatBoard
   Board sync_board;
   Sampler sampler(sync_board, gammas);
@@ -221,35 +516,60 @@ void Engine::SyncRoot () {
 
   EnsureAllLegalChildren (base_node, base_board, sampler);
   RemoveIllegalChildren (base_node, base_board);
-  cerr << endl << base_node->RecToString (100, 6) << endl;
+  UpdateLiveStats ();
+  if (!quiet) LOG (Log::Debug, endl << base_node->RecToString (param, 100, 6));
 }
 
 
 void Engine::DoOnePlayout (bool use_tree, bool update_tree) {
   bool tree_phase = use_tree;
+  uint tree_depth = 0;
+  SEARCH_PROFILE_DO (profile.Mark ());
   PrepareToPlayout();
+  SEARCH_PROFILE_DO (profile.Charge (SearchProfile::Setup));
 
   // do the playout
   while (true) {
     if (playout_board.BothPlayerPass()) break;
-    if (playout_board.MoveCount() >= 3*Board::kArea) return;
+    if (playout_board.MoveCount() >= 3*Board::kArea) {
+      SEARCH_PROFILE_DO (profile.Charge (SearchProfile::Playout));
+      profile.AddPlayout (tree_depth, playout_moves.Size ());
+      return;
+    }
 
     Move m = Move::Invalid ();
     if (!m.IsValid()) m = ChooseMctsMove (&tree_phase);
     if (!m.IsValid()) m = Move (playout_board.ActPlayer (), sampler.SampleMove (random));
     PlayMove (m);
+    if (tree_phase) {
+      tree_depth += 1;
+      SEARCH_PROFILE_DO (profile.Charge (SearchProfile::Descent));
+    }
+  }
+  SEARCH_PROFILE_DO (profile.Charge (SearchProfile::Playout));
+  profile.AddPlayout (tree_depth, playout_moves.Size ());
+
+  // A sample keeps the full-board scan off most playouts.
+  ownership_skip += 1;
+  if (ownership_skip >= kOwnershipStride) {
+    ownership_skip = 0;
+    ownership [use_tree].Add (playout_board);
   }
 
   if (update_tree) {
     double score = Score (tree_phase);
+    SEARCH_PROFILE_DO (profile.Charge (SearchProfile::Scoring));
     trace.UpdateTraceRegular (score);
+    SEARCH_PROFILE_DO (profile.Charge (SearchProfile::Backup));
+  } else {
+    SEARCH_PROFILE_DO (profile.Charge (SearchProfile::Scoring));
   }
 }
 
 
 void Engine::PrepareToPlayout () {
   playout_board.Load (base_board);
-  playout_moves.clear();
+  playout_moves.Clear ();
   sampler.NewPlayout ();
 
   trace.Reset (*base_node);
@@ -264,32 +584,43 @@ Move Engine::ChooseMctsMove (bool* tree_phase) {
   }
 
   if (!playout_node->has_all_legal_children [pl]) {
-    if (!playout_node->ReadyToExpand ()) {
+    if (!playout_node->ReadyToExpand (param)) {
       *tree_phase = false;
       return Move::Invalid();
     }
     ASSERT (pl == playout_node->player.Other());
-    EnsureAllLegalChildren (playout_node, playout_board, sampler);
+    SEARCH_PROFILE_DO (profile.Charge (SearchProfile::Descent));
+    uint added;
+    {
+      TRACE_SPAN ("Expansion");
+      added = EnsureAllLegalChildren (playout_node, playout_board, sampler);
+    }
+    SEARCH_PROFILE_DO (profile.Charge (SearchProfile::Expansion));
+    profile.AddExpansion (added);
   }
 
-  MctsNode& uct_child = playout_node->BestRaveChild (pl);
+  MctsNode& uct_child = playout_node->BestRaveChild (pl, param);
   trace.NewNode (uct_child);
   playout_node = &uct_child;
   ASSERT (uct_child.v != Vertex::Any());
   return Move (pl, uct_child.v);
 }
 
-void Engine::EnsureAllLegalChildren (MctsNode* node, const Board& board, const Sampler& sampler) {
+uint Engine::EnsureAllLegalChildren (MctsNode* node, const RawBoard& board, const Sampler& sampler) {
   Player pl = board.ActPlayer ();
-  if (node->has_all_legal_children [pl]) return;
+  if (node->has_all_legal_children [pl]) return 0;
+  uint added = 0;
   empty_v_for_each_and_pass (&board, v, {
       // superko nodes have to be removed from the tree later
       if (board.IsLegal (pl, v)) {
       double bias = sampler.Probability (pl, v);
-      node->AddChild (MctsNode(pl, v, bias));
+      node->AddChild (MctsNode(pl, v, bias, param));
+      added += 1;
       }
       });
   node->has_all_legal_children [pl] = true;
+  live_nodes += added;
+  return added;
 }
 
 
@@ -300,6 +631,7 @@ void Engine::RemoveIllegalChildren (MctsNode* node, const Board& board) {
   MctsNode::ChildrenList::iterator child = node->children.begin();
   while (child != node->children.end()) {
     if (child->player == pl && !board.IsReallyLegal (Move (pl, child->v))) {
+      live_nodes -= child->SubtreeSize ();
       node->children.erase (child++);
     } else {
       ++child;
@@ -315,12 +647,12 @@ void Engine::PlayMove (Move m) {
   trace.NewMove (m);
   sampler.MovePlayed ();
 
-  playout_moves.push_back (m);
+  playout_moves.Push (m);
 }
 
 
 vector<Move> Engine::LastPlayout () {
-  return playout_moves;
+  return playout_moves.AsVector ();
 }
 
 
@@ -5,19 +5,33 @@
 #ifndef ENGINE_H_
 #define ENGINE_H_
 
+#include <chrono>
+#include <mutex>
+
 #include "to_string.hpp"
+#include "log.hpp"
+#include "trace.hpp"
 #include "gtp_gogui.hpp"
 #include "ego.hpp"
 #include "time_control.hpp"
 #include "mcts_tree.hpp"
+#include "search_profile.hpp"
+
+class PlayoutPool;
 
 class Engine {
 public:
-  Engine ();
+  // Gammas are only read, so many engines can share one table.
+  explicit Engine (const Gammas& gammas);
 
   bool Reset (uint board_size);
   void SetKomi (float komi);
   bool Play (Move move);
+
+  // Replaces the game with the given moves, syncing the tree once.
+  // Returns the number of legal moves; if it is less than moves.size ()
+  // the previous position is kept.
+  uint SetPosition (const vector<Move>& moves);
   Move Genmove (Player player);
   bool Undo ();
 
@@ -25,9 +39,34 @@ public:
 
   const Board& GetBoard () const;
 
+  // Statistics of the last genmove.
+  const SearchProfile& GetSearchProfile () const;
+
+  // Search and tree statistics as "key value" lines.
+  // Not thread safe, the engine must not be searching.
+  string StatsToString () const;
+
+  // StatsToString as of at most a second ago. Safe to call from any
+  // thread, also while a search runs.
+  string LiveStatsToString () const;
+
+  // Per-engine search settings.
+  Param& GetParam ();
+
+  // When set, DoNPlayouts runs on the pool's threads instead of
+  // the calling one. NULL (default) means no pool.
+  void SetPlayoutPool (PlayoutPool* pool);
+
+  // Quiet engine does not dump the board and tree on every position change.
+  void SetQuiet (bool quiet);
+
   // Playout functions
   Move ChooseBestMove ();
   void DoNPlayouts (uint n);
+
+  // Most explored move in the current position and its mean result
+  // in [-1, 1] from the point of view of the player to move.
+  Move MostExploredMove (double* mean);
   void SyncRoot ();
   void PrepareToPlayout ();
   void DoOnePlayout (bool use_tree, bool update_tree);
@@ -55,14 +94,44 @@ public:
   std::string GetStringForVertex (Vertex v);
   vector<Move> LastPlayout ();
 
-  void EnsureAllLegalChildren (MctsNode* node, const Board& board, const Sampler& sampler);
+  // Returns the number of added children.
+  uint EnsureAllLegalChildren (MctsNode* node, const RawBoard& board, const Sampler& sampler);
   void RemoveIllegalChildren (MctsNode* node, const Board& board);
 
 private:
+  // Per-vertex sum of final owners (+1 black, -1 white) over playouts.
+  struct Ownership {
+    NatMap <Vertex, int> sum;
+    uint count;
+
+    void Reset ();
+    void Add (const RawBoard& board);
+    void Merge (const Ownership& other);
+  };
+
   void EstimateTerritory (NatMap<Vertex, double>& influence, bool use_tree);
+  void LogBoard () const;
+  void SampleOwnership (uint n, bool use_tree);
+  // One thread's share of SampleOwnership.
+  struct OwnershipPart {
+    uint n;
+    uint seed;
+    Ownership result;
+  };
+
+  void SampleOwnershipPart (bool use_tree, vector <OwnershipPart>* parts, uint ii);
+  void SampleOwnershipThread (uint n, bool use_tree, uint seed, Ownership* result);
+  void ResetOwnership ();
+  void ResetTree ();
+  // Play without dropping the ownership collected so far.
+  bool PlayKeepingOwnership (Move move);
+  void UpdateLiveStats ();
 
+  Param param;
   TimeControl time_control;
-  Gammas gammas;
+  const Gammas& gammas;
+  PlayoutPool* playout_pool;
+  bool quiet;
 
   FastRandom random;
 
@@ -72,12 +141,39 @@ private:
   Board base_board;
   MctsNode* base_node;
   
-  Board playout_board;
+  // Playout state is fixed size, the playout loop does not allocate.
+  RawBoard playout_board;
   MctsNode* playout_node;
 
-  vector<Move> playout_moves;
+  FastStack <Move, 3*Board::kArea> playout_moves;
   MctsTrace trace;
 
+  // Collected from every kOwnershipStride-th finished playout, indexed by
+  // use_tree. Reset by every position change and at the start of every
+  // genmove; the genmove's own move keeps its search's samples.
+  static const uint kOwnershipStride = 16;
+  Ownership ownership [2];
+  uint ownership_skip;
+
+  SearchProfile profile;
+
+  // Counters for StatsToString, the rest comes from the profile.
+  uint64 session_playouts;
+  double session_seconds;
+  uint64 session_nodes;
+  uint64 live_nodes;      // in the tree, updated as it grows and shrinks
+  uint64 last_playouts;
+  double last_seconds;
+  bool searching;
+  chrono::steady_clock::time_point search_begin;
+
+  // Refreshed between chunks of kLiveStatsChunk playouts of a search,
+  // read by LiveStatsToString.
+  static const uint kLiveStatsChunk = 4096;
+  mutable std::mutex live_stats_mutex;
+  string live_stats;
+  chrono::steady_clock::time_point live_stats_time;
+
   friend class MctsGtp;
 };
 
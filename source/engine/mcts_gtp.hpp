@@ -3,12 +3,14 @@
 
 #include <fstream>
 
-extern Gtp::ReplWithGogui gtp;
+#include "gtp_gogui.hpp"
+#include "engine.hpp"
 
+// Registers commands and params of one engine in the given GTP repl.
 class MctsGtp {
 public:
-  MctsGtp (Engine& engine)
-  : engine (engine)
+  MctsGtp (Gtp::ReplWithGogui& gtp, Engine& engine)
+  : gtp (gtp), engine (engine)
   {
     RegisterCommands ();
     RegisterParams ();
@@ -22,11 +24,15 @@ private:
     gtp.Register ("komi",         this, &MctsGtp::Ckomi);
     gtp.Register ("play",         this, &MctsGtp::Cplay);
     gtp.Register ("undo",         this, &MctsGtp::Cundo);
+    gtp.Register ("set_position", this, &MctsGtp::Cset_position);
+    gtp.Register ("loadsgf",      this, &MctsGtp::Cloadsgf);
+    gtp.Register ("final_status_list", this, &MctsGtp::Cfinal_status_list);
+    gtp.Register ("search_profile", this, &MctsGtp::Csearch_profile);
+    gtp.Register ("stats",        this, &MctsGtp::Cstats);
     gtp.Register ("genmove",      this, &MctsGtp::Cgenmove);
     gtp.Register ("showboard",    this, &MctsGtp::Cshowboard);
     gtp.Register ("gui",          this, &MctsGtp::Cgui);
-
-    gtp.Register ("LoadGammas",   this, &MctsGtp::CLoadGammas);
+    gtp.Register ("time_left",    &engine.time_control, &TimeControl::GtpTimeLeft);
 
     gtp.RegisterGfx ("DoPlayouts",      "1", this, &MctsGtp::CDoPlayouts);
     gtp.RegisterGfx ("DoPlayouts",     "10", this, &MctsGtp::CDoPlayouts);
@@ -54,23 +60,25 @@ private:
     string other = "param.other";
     string set = "set";
 
-    gtp.RegisterParam (other, "genmove_playouts",     &Param::genmove_playouts);
-    gtp.RegisterParam (other, "local_use",            &Param::use_local);
+    gtp.RegisterParam (other, "genmove_playouts",     &engine.param.genmove_playouts);
+    gtp.RegisterParam (other, "local_use",            &engine.param.use_local);
     gtp.RegisterParam (other, "seed",                 &engine.random.seed);
-
-    gtp.RegisterParam (tree, "use",             &Param::tree_use);
-    gtp.RegisterParam (tree, "max_moves",       &Param::tree_max_moves);
-    gtp.RegisterParam (tree, "explore_coeff",   &Param::tree_explore_coeff);
-    gtp.RegisterParam (tree, "rave_update",     &Param::tree_rave_update);
-    gtp.RegisterParam (tree, "rave_use",        &Param::tree_rave_use);
-    gtp.RegisterParam (tree, "stat_bias",       &Param::tree_stat_bias);
-    gtp.RegisterParam (tree, "rave_bias",       &Param::tree_rave_bias);
-    gtp.RegisterParam (tree, "rave_update_fraction", &Param::tree_rave_update_fraction);
-    gtp.RegisterParam (tree, "progressive_bias",&Param::tree_progressive_bias);
-
-    gtp.RegisterParam (set, "progressive_bias",       &Param::tree_progressive_bias);
-    gtp.RegisterParam (set, "progressive_bias_prior", &Param::tree_progressive_bias_prior);
-    gtp.RegisterParam (set, "explore_coeff",          &Param::tree_explore_coeff);
+    gtp.RegisterParam (other, "ownership_playouts",   &engine.param.ownership_playouts);
+    gtp.RegisterParam (other, "ownership_threads",    &engine.param.ownership_threads);
+
+    gtp.RegisterParam (tree, "use",             &engine.param.tree_use);
+    gtp.RegisterParam (tree, "max_moves",       &engine.param.tree_max_moves);
+    gtp.RegisterParam (tree, "explore_coeff",   &engine.param.tree_explore_coeff);
+    gtp.RegisterParam (tree, "rave_update",     &engine.param.tree_rave_update);
+    gtp.RegisterParam (tree, "rave_use",        &engine.param.tree_rave_use);
+    gtp.RegisterParam (tree, "stat_bias",       &engine.param.tree_stat_bias);
+    gtp.RegisterParam (tree, "rave_bias",       &engine.param.tree_rave_bias);
+    gtp.RegisterParam (tree, "rave_update_fraction", &engine.param.tree_rave_update_fraction);
+    gtp.RegisterParam (tree, "progressive_bias",&engine.param.tree_progressive_bias);
+
+    gtp.RegisterParam (set, "progressive_bias",       &engine.param.tree_progressive_bias);
+    gtp.RegisterParam (set, "progressive_bias_prior", &engine.param.tree_progressive_bias_prior);
+    gtp.RegisterParam (set, "explore_coeff",          &engine.param.tree_explore_coeff);
 
     gtp.RegisterParam (set, "proxy_1_bonus", &engine.sampler.proximity_bonus[0]);
     gtp.RegisterParam (set, "proxy_2_bonus", &engine.sampler.proximity_bonus[1]);
@@ -121,13 +129,104 @@ private:
     }
   }
 
+  // Usage: set_position [color vertex]*
+  void Cset_position (Gtp::Io& io) {
+    vector<Move> moves;
+    while (!io.IsEmpty ()) moves.push_back (io.Read<Move> ());
+    SetPosition (io, moves);
+  }
+
+  // Usage: loadsgf file_name [move_number]
+  // Position is set up just before move_number (counting setup stones).
+  void Cloadsgf (Gtp::Io& io) {
+    string file_name = io.Read<string> ();
+    uint move_number = io.Read<uint> (0);
+    io.CheckEmpty ();
+
+    ifstream in (file_name.c_str ());
+    if (!in) {
+      io.SetError ("cannot open file");
+      return;
+    }
+    Sgf::Game game;
+    if (!Sgf::ReadGame (in, &game)) {
+      io.SetError ("cannot parse sgf");
+      return;
+    }
+    if (game.board_size != board_size) {
+      io.SetError ("unacceptable size");
+      return;
+    }
+    if (move_number > 0 && move_number - 1 < game.moves.size ()) {
+      game.moves.resize (move_number - 1);
+    }
+    if (SetPosition (io, game.moves)) {
+      engine.SetKomi (game.komi);
+    }
+  }
+
+  bool SetPosition (Gtp::Io& io, const vector<Move>& moves) {
+    uint legal_count = engine.SetPosition (moves);
+    if (legal_count < moves.size ()) {
+      io.SetError ("illegal move " + ToString (legal_count + 1) + ": " +
+                   moves [legal_count].ToGtpString ());
+      return false;
+    }
+    return true;
+  }
+
+  // Usage: final_status_list alive|dead|seki|black_territory|white_territory
+  // Based on the ownership of the last search (kept across its genmove),
+  // topped up with extra playouts when it has too few.
+  void Cfinal_status_list (Gtp::Io& io) {
+    string status = io.Read<string> ();
+    io.CheckEmpty ();
+    if (status != "alive" && status != "dead" && status != "seki" &&
+        status != "black_territory" && status != "white_territory") {
+      io.SetError ("unknown status: " + status);
+      return;
+    }
+
+    NatMap <Vertex, double> ownership;
+    engine.GetInfluence (Engine::MctsTerritory, ownership);
+    const Board& board = engine.GetBoard ();
+
+    ForEachNat (Vertex, v) {
+      if (!v.IsOnBoard ()) continue;
+      Color color = board.ColorAt (v);
+      // Owner of the vertex at the end of most playouts.
+      Color owner =
+        ownership [v] >  0.5 ? Color::Black () :
+        ownership [v] < -0.5 ? Color::White () :
+        Color::Empty ();
+      bool dead = color.IsPlayer () && owner.IsPlayer () && owner != color;
+      bool listed =
+        status == "alive" ? color.IsPlayer () && !dead :
+        status == "dead"  ? dead :
+        status == "black_territory" ? owner == Color::Black () && color != owner :
+        status == "white_territory" ? owner == Color::White () && color != owner :
+        false;
+      if (listed) io.out << v.ToGtpString () << " ";
+    }
+  }
+
+  void Csearch_profile (Gtp::Io& io) {
+    io.CheckEmpty ();
+    io.out << endl << engine.GetSearchProfile ().ToString ();
+  }
+
+  void Cstats (Gtp::Io& io) {
+    io.CheckEmpty ();
+    io.out << endl << engine.StatsToString ();
+  }
+
   void Cshowboard (Gtp::Io& io) {
     io.CheckEmpty ();
     io.out << engine.GetBoard().ToAsciiArt ();
   }
 
   void CDoPlayouts (Gtp::Io& io) {
-    uint n = io.Read <uint> (Param::genmove_playouts);
+    uint n = io.Read <uint> (engine.param.genmove_playouts);
     io.CheckEmpty();
     engine.DoNPlayouts (n);
   }
@@ -185,32 +284,17 @@ private:
     uint min_updates  = io.Read <uint> ();
     uint max_children = io.Read <uint> ();
     io.CheckEmpty();
-    io.out << endl << engine.base_node->RecToString (min_updates, max_children);
+    io.out << endl << engine.base_node->RecToString (engine.param, min_updates, max_children);
   }
 
 
-  void CLoadGammas (Gtp::Io& io) {
-    string file_name = io.Read<string> ();
-    io.CheckEmpty ();
-    ifstream in;
-    in.open (file_name.c_str(), ifstream::in);
-    if (!in.good()) {
-      io.SetError ("Can't open a file: " + file_name);
-      return;
-    }
-    if (!engine.gammas.Read (in)) {
-      io.SetError ("File in a bad format.");
-      return;
-    }
-    in.close();
-  }
-
   void Cgui (Gtp::Io& io) {
     io.CheckEmpty ();
     //RunGui (engine);
   }
 
 private:
+  Gtp::ReplWithGogui& gtp;
   Engine& engine;
 };
 
@@ -3,25 +3,43 @@
 #include "mcts_tree.hpp"
 #include "gtp_gogui.hpp"
 
-extern Gtp::ReplWithGogui gtp;
-
-MctsNode::MctsNode (Player player, Vertex v, double bias)
+MctsNode::MctsNode (Player player, Vertex v, double bias, const Param& param)
 : player(player), v(v), has_all_legal_children (false), bias(bias)
 {
   ASSERT2 (!qisnan (bias), WW(bias));
   ASSERT2 (bias >= 0.0, WW(bias));
   ASSERT2 (bias <= 1.0, WW(bias));
-  Reset ();
+  Reset (param);
 }
 
 Move MctsNode::GetMove () const {
   return Move(player, v);
 }
 
+void MctsNode::ReserveNodes (uint n) {
+  // The list node type is private to std::list, so fill a scratch list
+  // and let its nodes fall back into the pool.
+  ChildrenList scratch;
+  MctsNode node (Player::Black (), Vertex::Pass (), 0.0, Param ());
+  rep (ii, n) scratch.push_front (node);
+}
+
+
 void MctsNode::AddChild (const MctsNode& node) {
   children.push_front (node);
 }
 
+uint MctsNode::SubtreeSize () const {
+  uint size = 1;
+  for (ChildrenList::const_iterator child = children.begin();
+       child != children.end();
+       ++child)
+  {
+    size += child->SubtreeSize ();
+  }
+  return size;
+}
+
 // TODO better implementation of child removation.
 void MctsNode::RemoveChild (MctsNode* child_ptr) {
   ChildrenList::iterator child = children.begin();
@@ -35,9 +53,9 @@ void MctsNode::RemoveChild (MctsNode* child_ptr) {
   }
 }
 
-bool MctsNode::ReadyToExpand () const {
+bool MctsNode::ReadyToExpand (const Param& param) const {
   return stat.update_count() > 
-    Param::prior_update_count + Param::mature_update_count;
+    param.prior_update_count + param.mature_update_count;
 }
 
 MctsNode* MctsNode::FindChild (Move m) {
@@ -57,15 +75,15 @@ MctsNode* MctsNode::FindChild (Move m) {
   return NULL; // no child
 }
 
-string MctsNode::ToString() const {
+string MctsNode::ToString (const Param& param) const {
   stringstream s;
   s << player.ToGtpString() << " " 
     << v.ToGtpString() << " " 
     << stat.to_string() << " "
     << rave_stat.to_string() << " + "
     << bias << " -> "
-    << Stat::Mix (stat,      Param::tree_stat_bias,
-        rave_stat, Param::tree_rave_bias)
+    << Stat::Mix (stat,      param.tree_stat_bias,
+        rave_stat, param.tree_rave_bias)
     // << " - ("  << stat.precision (Param::mcts_bias) << " : "
     // << stat.precision (Param::rave_bias) << ")"
     // << Stat::SlowMix (stat,
@@ -77,7 +95,7 @@ string MctsNode::ToString() const {
   return s.str();
 }
 
-string MctsNode::GuiString() const {
+string MctsNode::GuiString (const Param& param) const {
   stringstream s;
   s << player.ToGtpString() << " " 
     << v.ToGtpString() << endl
@@ -85,8 +103,8 @@ string MctsNode::GuiString() const {
     << "RAVE: " << rave_stat.to_string() << endl
     << "Bias: " << bias << endl
     << "Mix:  "
-    << Stat::Mix (stat,      Param::tree_stat_bias,
-                  rave_stat, Param::tree_rave_bias) << endl
+    << Stat::Mix (stat,      param.tree_stat_bias,
+                  rave_stat, param.tree_rave_bias) << endl
     ;
 
   return s.str();
@@ -99,9 +117,10 @@ namespace {
   }
 }
 
-void MctsNode::RecPrint (ostream& out, uint depth, float min_visit, uint max_children) const {
+void MctsNode::RecPrint (ostream& out, const Param& param,
+                         uint depth, float min_visit, uint max_children) const {
   rep (d, depth) out << "  ";
-  out << ToString () << endl;
+  out << ToString (param) << endl;
 
   vector <const MctsNode*> child_tab;
   for (ChildrenList::const_iterator child = children.begin();
@@ -117,14 +136,15 @@ void MctsNode::RecPrint (ostream& out, uint depth, float min_visit, uint max_chi
   rep(ii, child_tab.size()) {
     const MctsNode* child = child_tab[ii];
     if (child->stat.update_count() >= min_visit) {
-      child->RecPrint (out, depth + 1, min_visit, max(1u, max_children - 1));
+      child->RecPrint (out, param, depth + 1, min_visit, max(1u, max_children - 1));
     }
   }
 }
 
-string MctsNode::RecToString (float min_visit, uint max_children) const { 
+string MctsNode::RecToString (const Param& param,
+                               float min_visit, uint max_children) const {
   ostringstream out;
-  RecPrint (out, 0, min_visit, max_children); 
+  RecPrint (out, param, 0, min_visit, max_children);
   return out.str ();
 }
 
@@ -149,7 +169,7 @@ const MctsNode& MctsNode::MostExploredChild (Player pl) const {
 }
 
 
-MctsNode& MctsNode::BestRaveChild (Player pl) {
+MctsNode& MctsNode::BestRaveChild (Player pl, const Param& param) {
   MctsNode* best_child = NULL;
   float best_urgency = -100000000000000.0; // TODO infinity
   const float log_val = log (stat.update_count());
@@ -161,7 +181,7 @@ MctsNode& MctsNode::BestRaveChild (Player pl) {
        ++child)
   {
     if (child->player != pl) continue;
-    float child_urgency = child->SubjectiveRaveValue (pl, log_val);
+    float child_urgency = child->SubjectiveRaveValue (pl, log_val, param);
     if (child_urgency > best_urgency) {
       best_urgency = child_urgency;
       best_child   = &*child;
@@ -173,65 +193,70 @@ MctsNode& MctsNode::BestRaveChild (Player pl) {
 }
 
 
-void MctsNode::Reset () {
+void MctsNode::Reset (const Param& param) {
   has_all_legal_children.SetAll (false);
   children.clear ();
-  stat.reset      (Param::prior_update_count,
-      player.SubjectiveScore (Param::prior_mean));
-  rave_stat.reset (Param::prior_update_count,
-      player.SubjectiveScore (Param::prior_mean));
+  stat.reset      (param.prior_update_count,
+      player.SubjectiveScore (param.prior_mean));
+  rave_stat.reset (param.prior_update_count,
+      player.SubjectiveScore (param.prior_mean));
 }
 
 float MctsNode::SubjectiveMean () const {
   return player.SubjectiveScore (stat.mean ());
 }
 
-float MctsNode::SubjectiveRaveValue (Player pl, float log_val) const {
+float MctsNode::SubjectiveRaveValue (Player pl, float log_val,
+                                     const Param& param) const {
   float value;
 
-  if (Param::tree_rave_use) {
-    value = Stat::Mix (stat,      Param::tree_stat_bias,
-        rave_stat, Param::tree_rave_bias);
+  if (param.tree_rave_use) {
+    value = Stat::Mix (stat,      param.tree_stat_bias,
+        rave_stat, param.tree_rave_bias);
   } else {
     value = stat.mean ();
   }
 
   return
     pl.SubjectiveScore (value)
-    + Param::tree_explore_coeff * sqrt (log_val / stat.update_count())
-    + Param::tree_progressive_bias * bias
-    / max (1.0f, (stat.update_count () + Param::tree_progressive_bias_prior));
+    + param.tree_explore_coeff * sqrt (log_val / stat.update_count())
+    + param.tree_progressive_bias * bias
+    / max (1.0f, (stat.update_count () + param.tree_progressive_bias_prior));
   // TODO other equation for PB
 }
 
 
 // -----------------------------------------------------------------------------
 
+MctsTrace::MctsTrace (const Param& param) : param (param) {
+}
+
+
 void MctsTrace::Reset (MctsNode& node) {
-  nodes.clear();
-  nodes.push_back (&node);
-  moves.clear ();
-  moves.push_back (node.GetMove());
+  nodes.Clear ();
+  nodes.Push (&node);
+  moves.Clear ();
+  moves.Push (node.GetMove());
 }
 
 
 void MctsTrace::NewNode (MctsNode& node) {
-  nodes.push_back (&node);  
+  nodes.Push (&node);
 }
 
 
 void MctsTrace::NewMove (Move m) {
-  moves.push_back (m);
+  moves.Push (m);
 }
 
 
 void MctsTrace::UpdateTraceRegular (float score) {
 
-  rep (ii, nodes.size ()) {
+  rep (ii, nodes.Size ()) {
     nodes[ii]->stat.update (score);
   }
 
-  if (Param::tree_rave_update) {
+  if (param.tree_rave_update) {
     UpdateTraceRave (score);
   }
 }
@@ -240,10 +265,10 @@ void MctsTrace::UpdateTraceRegular (float score) {
 void MctsTrace::UpdateTraceRave (float score) {
   // TODO configure rave blocking through options
 
-  uint last_ii  = moves.size () * Param::tree_rave_update_fraction;
+  uint last_ii  = moves.Size () * param.tree_rave_update_fraction;
   // TODO tune that
 
-  rep (act_ii, nodes.size()) {
+  rep (act_ii, nodes.Size ()) {
     // Mark moves that should be updated in RAVE children of: trace [act_ii]
     NatMap <Move, bool> do_update (false);
     NatMap <Move, bool> do_update_set_to (true);
@@ -2,26 +2,36 @@
 #define MCTS_TREE_
 
 #include <list>
+#include "fast_stack.hpp"
+#include "pool_allocator.hpp"
 #include "stat.hpp"
+#include "param.hpp"
 #include "gtp.hpp"
 
 
 class MctsNode {
 public:
-  typedef std::list<MctsNode> ChildrenList; // TODO vector, allocator?
+  // Nodes come from the block pool, so the steady-state search does not
+  // allocate once the pool is warm (see ReserveNodes). The engine does
+  // not reserve; the pool warms up during the first searches.
+  typedef std::list<MctsNode, PoolAllocator<MctsNode> > ChildrenList;
 
   // Initialization.
 
-  explicit MctsNode (Player player, Vertex v, double bias);
+  explicit MctsNode (Player player, Vertex v, double bias, const Param& param);
 
-  void Reset ();
+  void Reset (const Param& param);
+
+  // Grows the node pool so that n more nodes can be added without
+  // touching the heap.
+  static void ReserveNodes (uint n);
 
   // Printing.
 
-  string ToString() const;
-  string GuiString() const;
+  string ToString (const Param& param) const;
+  string GuiString (const Param& param) const;
 
-  string RecToString (float min_visit, uint max_children) const; 
+  string RecToString (const Param& param, float min_visit, uint max_children) const;
 
   // Children operations.
   
@@ -29,7 +39,10 @@ public:
 
   void RemoveChild (MctsNode* child_ptr);
 
-  bool ReadyToExpand () const;
+  // Number of nodes including this one.
+  uint SubtreeSize () const;
+
+  bool ReadyToExpand (const Param& param) const;
 
   // Child finding.
 
@@ -37,13 +50,13 @@ public:
 
   const MctsNode& MostExploredChild (Player pl) const;
 
-  MctsNode& BestRaveChild (Player pl);
+  MctsNode& BestRaveChild (Player pl, const Param& param);
 
   // Other.
   
   float SubjectiveMean() const;
 
-  float SubjectiveRaveValue (Player pl, float log_val) const;
+  float SubjectiveRaveValue (Player pl, float log_val, const Param& param) const;
 
 public:
 
@@ -57,7 +70,8 @@ public:
   Stat rave_stat;
   const double bias;
 
-  void RecPrint (ostream& out, uint depth, float min_visit, uint max_children) const;
+  void RecPrint (ostream& out, const Param& param,
+                 uint depth, float min_visit, uint max_children) const;
 
   ChildrenList children;
 };
@@ -66,6 +80,7 @@ public:
 
 struct MctsTrace {
 public:
+  explicit MctsTrace (const Param& param);
 
   void Reset (MctsNode& node);
   void NewMove (Move m);
@@ -74,8 +89,12 @@ public:
   void UpdateTraceRave (float score);
 
 private:
-  vector <MctsNode*> nodes;
-  vector <Move> moves;
+  // Root move plus at most one move per playout move.
+  static const uint kMaxLength = 3 * Board::kArea + 1;
+
+  const Param& param;
+  FastStack <MctsNode*, kMaxLength> nodes;
+  FastStack <Move, kMaxLength> moves;
 };
 
 // -----------------------------------------------------------------------------
@@ -0,0 +1,599 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "mm.hpp"
+
+namespace Mm {
+
+// -----------------------------------------------------------------------------
+
+Gammas::Gammas () {
+  gammas.resize (feature_count);
+  w.resize (feature_count);
+  rep (feature, feature_count) {
+    gammas [feature].resize (level_count [feature]);
+    w [feature].resize (level_count [feature]);
+  }
+  Reset ();
+}
+
+void Gammas::Reset () {
+  rep (feature , feature_count) {
+    rep (level , level_count [feature]) {
+      Set (feature, level, 1.0);
+      w [feature] [level] = 0.0;
+    }
+  }
+  t = 1.5; // TODO parameter
+}
+
+void Gammas::Normalize () {
+  rep (feature, feature_count) {
+    double log_sum = 1.0;
+    double n = 0.0;
+    rep (level, level_count [feature]) {
+      log_sum += log (Get (feature, level));
+      n += 1.0;
+    }
+
+    double mul = exp (log_sum / n);
+
+    rep (level, level_count [feature]) {
+      gammas [feature] [level] /= mul;
+    }
+  }
+}
+
+double Gammas::Distance (const Gammas& other) {
+  double sum = 0.0;
+
+  rep (feature , feature_count) {
+    rep (level , level_count [feature]) {
+      double d = log (Get (feature, level) / other.Get(feature, level));
+      sum += d*d;
+    }
+  }
+
+  return sqrt(sum);
+}
+
+string Gammas::ToString () {
+  ostringstream out;
+  rep (feature , feature_count) {
+    rep (level , level_count [feature]) {
+      out << setprecision(5) << setw (8) << log (Get (feature, level)) << " ";
+    }
+    out << " | ";
+  }
+  return out.str ();
+}
+
+// -----------------------------------------------------------------------------
+
+MatchSet::MatchSet () : team_begin (1, 0) {
+}
+
+void MatchSet::NewMatch () {
+  team_begin.push_back (team_begin.back ());
+  winners.push_back (uint (-1));
+}
+
+void MatchSet::NewTeam () {
+  CHECK (MatchCount () > 0);
+  team_begin.back () += 1;
+  rep (feature, feature_count) levels.push_back (0);
+}
+
+void MatchSet::SetFeatureLevel (uint feature, uint level) {
+  CHECK (feature < feature_count);
+  CHECK (level < level_count [feature]);
+  CHECK (levels.size () > 0);
+  levels [levels.size () - feature_count + feature] = level;
+}
+
+void MatchSet::SetWinnerLastTeam () {
+  CHECK (TeamCount () > TeamBegin (MatchCount () - 1));
+  winners.back () = TeamCount () - 1;
+}
+
+void MatchSet::SetRandomWinner (const Gammas& gammas, FastRandom& random) {
+  uint match = MatchCount () - 1;
+  double sum = TotalGamma (gammas, match);
+  double sample = random.NextDouble (sum);
+  double sum2 = 0.0;
+  for (uint team = TeamBegin (match); team != TeamEnd (match); team++) {
+    sum2 += TeamGamma (gammas, team);
+    if (sum2 >= sample) {
+      winners.back () = team;
+      break;
+    }
+  }
+}
+
+void MatchSet::Append (MatchSet& other) {
+  uint team_offset = TeamCount ();
+  reps (ii, 1, other.team_begin.size ()) {
+    team_begin.push_back (team_offset + other.team_begin [ii]);
+  }
+  rep (ii, other.winners.size ()) {
+    winners.push_back (team_offset + other.winners [ii]);
+  }
+  levels.insert (levels.end (), other.levels.begin (), other.levels.end ());
+  other = MatchSet ();
+}
+
+double MatchSet::TotalGamma (const Gammas& gammas, uint match) const {
+  double sum = 0.0;
+  for (uint team = TeamBegin (match); team != TeamEnd (match); team++) {
+    sum += TeamGamma (gammas, team);
+  }
+  return sum;
+}
+
+double MatchSet::TotalGammaDiff (const Gammas& gammas, uint match,
+                                 uint feature, uint level) const {
+  double sum = 0.0;
+  for (uint team = TeamBegin (match); team != TeamEnd (match); team++) {
+    if (Level (team, feature) == level) {
+      sum += TeamGamma (gammas, team) / gammas.Get (feature, level);
+    }
+  }
+  return sum;
+}
+
+double MatchSet::LogLikelihood (const Gammas& gammas, uint begin, uint end) const {
+  double sum = 0.0;
+  for (uint match = begin; match != end; match++) {
+    sum += log (TeamGamma (gammas, winners [match]) / TotalGamma (gammas, match));
+  }
+  return sum;
+}
+
+void MatchSet::AddTeamShares (const Gammas& gammas, uint feature,
+                              uint begin, uint end, vector <double>* c_e) const {
+  vector <double> itg; // incomplete team gammas (without the feature)
+  for (uint match = begin; match != end; match++) {
+    uint first = team_begin [match];
+    uint last = team_begin [match + 1];
+    itg.resize (last - first);
+    double tg_sum = 0.0; // E in Remi's paper
+
+    for (uint team = first; team != last; team++) {
+      double incomplete = 1.0;
+      rep (other, feature_count) {
+        if (other != feature) incomplete *= gammas.Get (other, Level (team, other));
+      }
+      itg [team - first] = incomplete;
+      tg_sum += incomplete * gammas.Get (feature, Level (team, feature));
+    }
+
+    double tg_sum_inv = 1.0 / tg_sum;
+    for (uint team = first; team != last; team++) {
+      (*c_e) [Level (team, feature)] += itg [team - first] * tg_sum_inv;
+    }
+  }
+}
+
+double MatchSet::AddGradient (const Gammas& gammas, const uint* ids, uint count,
+                              vector <vector <double> >* gradient) const {
+  double ll = 0.0;
+  rep (ii, count) {
+    uint match = ids [ii];
+    double total = TotalGamma (gammas, match);
+    double total_inv = 1.0 / total;
+    for (uint team = team_begin [match]; team != team_begin [match + 1]; team++) {
+      // Derivative of log (winner / total) by log-gamma of a team's level.
+      double p = TeamGamma (gammas, team) * total_inv;
+      rep (feature, feature_count) {
+        (*gradient) [feature] [Level (team, feature)] -= p;
+      }
+    }
+    uint winner = winners [match];
+    rep (feature, feature_count) {
+      (*gradient) [feature] [Level (winner, feature)] += 1.0;
+    }
+    ll += log (TeamGamma (gammas, winner) * total_inv);
+  }
+  return ll;
+}
+
+void MatchSet::CopyMatch (const MatchSet& other, uint match) {
+  NewMatch ();
+  for (uint team = other.TeamBegin (match); team != other.TeamEnd (match); team++) {
+    NewTeam ();
+    rep (feature, feature_count) {
+      SetFeatureLevel (feature, other.Level (team, feature));
+    }
+    if (team == other.Winner (match)) SetWinnerLastTeam ();
+  }
+}
+
+string MatchSet::ToString (uint match) const {
+  ostringstream out;
+  for (uint team = TeamBegin (match); team != TeamEnd (match); team++) {
+    out << "(";
+    rep (feature, feature_count) {
+      out << (feature == 0 ? "" : " ") << Level (team, feature);
+    }
+    out << ")" << (Winner (match) == team ? "! " : "  ");
+  }
+  return out.str ();
+}
+
+// -----------------------------------------------------------------------------
+
+BtModel::BtModel () : random(123) {
+  act_match = 0;
+  prior_games = 4.0;
+  thread_count = 1;
+  patience = 3;
+}
+
+void BtModel::RunParallel (const function <void (uint)>& work) {
+  if (thread_count <= 1) {
+    work (0);
+    return;
+  }
+  if (!workers || workers->ThreadCount () != thread_count) {
+    workers.reset (new PlayoutPool (thread_count));
+  }
+  workers->Run (thread_count, work);
+}
+
+uint BtModel::SliceBegin (uint size, uint ii, uint n) {
+  return uint64 (size) * ii / n;
+}
+
+void BtModel::HoldOut (double fraction) {
+  validation = MatchSet ();
+  MatchSet train;
+  rep (ii, matches.MatchCount ()) {
+    MatchSet& target = random.NextDouble () < fraction ? validation : train;
+    target.CopyMatch (matches, ii);
+  }
+  swap (matches, train);
+}
+
+void BtModel::PreprocessData () {
+  gammas.Reset ();
+  rep (ii, matches.MatchCount ()) {
+    uint winner = matches.Winner (ii);
+    rep (feature , feature_count) {
+      uint level = matches.Level (winner, feature);
+      gammas.w [feature] [level] += 1.0;
+    }
+  }
+}
+
+void BtModel::TrainFeature (uint feature) {
+  // One c_e per thread, summed into the first one.
+  vector <vector <double> > c_e (max (thread_count, 1u),
+                                 vector <double> (level_count [feature], 0.0));
+  // prior
+  rep (level, level_count [feature]) {
+    c_e [0] [level] = prior_games / (gammas.Get (feature, level) + 1.0);
+  }
+
+  RunParallel (bind (&BtModel::AddTeamSharesSlice, this,
+                     feature, &c_e, placeholders::_1));
+  reps (ii, 1, c_e.size ()) {
+    rep (level, level_count [feature]) c_e [0] [level] += c_e [ii] [level];
+  }
+
+  rep (level, level_count [feature]) {
+    double new_gamma = (gammas.w [feature] [level] + prior_games / 2) / c_e [0] [level];
+    gammas.Set (feature, level, new_gamma);
+  }
+
+  gammas.Normalize ();
+}
+
+void BtModel::AddTeamSharesSlice (uint feature, vector <vector <double> >* c_e,
+                                  uint thread_no) {
+  uint n = c_e->size ();
+  uint begin = SliceBegin (matches.MatchCount (), thread_no, n);
+  uint end = SliceBegin (matches.MatchCount (), thread_no + 1, n);
+  matches.AddTeamShares (gammas, feature, begin, end, &(*c_e) [thread_no]);
+}
+
+void BtModel::Train (uint epochs) {
+  double ll_improve [feature_count];
+  rep (f, feature_count)  ll_improve [f] = 1000.0;
+
+  double last_ll = LogLikelihood();
+  cerr << "Begin LL: " << last_ll << endl;
+
+  rep (ii, epochs) {
+    uint best_f = 0;
+    rep (f, feature_count) {
+      if (ll_improve[f] > ll_improve[best_f]) {
+        best_f = f;
+      }
+    }
+
+    cerr << "Train feature " << best_f << " ... " << flush;
+    TrainFeature (best_f);
+
+    double new_ll = LogLikelihood();
+    ll_improve [best_f] = new_ll - last_ll;
+    last_ll = new_ll;
+    cerr << "New LL = " << new_ll << "; delta LL = " << ll_improve [best_f] << endl;
+  }
+}
+
+void BtModel::UpdateGamma (uint feature, uint level) {
+
+  // prior
+  double c_e = 2.0 / (gammas.Get (feature, level) + 1.0);
+
+  rep (ii, matches.MatchCount ()) {
+    double tgd = matches.TotalGammaDiff (gammas, ii, feature, level);
+    double tg  = matches.TotalGamma (gammas, ii);
+    c_e += tgd / tg;
+  }
+  // + 1.0 is prior
+  double w = gammas.w[feature][level] + 1.0;
+
+  gammas.Set (feature, level, w / c_e);
+}
+
+void BtModel::DoFullUpdate () {
+  rep (feature , feature_count) {
+    rep (level , level_count [feature]) {
+      UpdateGamma (feature, level);
+      //cerr << level << " "  << LogLikelihood() << endl;
+
+    }
+  }
+  gammas.Normalize ();
+}
+
+void BtModel::GradientUpdate (uint match) {
+  // Calculate probabilities
+  uint begin = matches.TeamBegin (match);
+  uint end = matches.TeamEnd (match);
+  p.resize (end - begin);
+  double sum = 0.0;
+  for (uint team = begin; team != end; team++) {
+    p [team - begin] = matches.TeamGamma (gammas, team);
+    sum += p [team - begin];
+  }
+  rep (ii, p.size ()) {
+    p [ii] /= sum;
+  }
+
+  TeamGradientUpdate (matches.Winner (match), 1.0); // update +alpha
+  for (uint team = begin; team != end; team++) {
+    TeamGradientUpdate (team, -p [team - begin]);
+  }
+}
+
+void BtModel::TeamGradientUpdate (uint team, double update) {
+  rep (feature, feature_count) {
+    gammas.LambdaUpdate (feature, matches.Level (team, feature), update);
+  }
+}
+
+void BtModel::DoGradientUpdate (uint n) {
+
+  rep (ii, n) {
+    GradientUpdate (act_match);
+    act_match += 1;
+    if (act_match >= matches.MatchCount ()) act_match = 0;
+  }
+  gammas.Normalize ();
+}
+
+double BtModel::LogLikelihood () {
+  return LogLikelihood (matches);
+}
+
+double BtModel::LogLikelihood (const MatchSet& set) {
+  vector <double> sums (max (thread_count, 1u), 0.0);
+  RunParallel (bind (&BtModel::LogLikelihoodSlice, this,
+                     &set, &sums, placeholders::_1));
+  double sum = 0.0;
+  rep (ii, sums.size ()) sum += sums [ii];
+  return sum / set.MatchCount ();
+}
+
+void BtModel::LogLikelihoodSlice (const MatchSet* set, vector <double>* sums,
+                                  uint thread_no) {
+  uint n = sums->size ();
+  uint begin = SliceBegin (set->MatchCount (), thread_no, n);
+  uint end = SliceBegin (set->MatchCount (), thread_no + 1, n);
+  (*sums) [thread_no] = set->LogLikelihood (gammas, begin, end);
+}
+
+void BtModel::TrainSgd (uint max_epochs, uint batch_size, double learning_rate) {
+  CHECK (validation.MatchCount () > 0);
+  CHECK (batch_size > 0);
+  uint match_count = matches.MatchCount ();
+
+  vector <vector <double> > log_gammas (feature_count);
+  vector <vector <double> > grad_sq_sum (feature_count);
+  rep (feature, feature_count) {
+    log_gammas [feature].resize (level_count [feature]);
+    grad_sq_sum [feature].assign (level_count [feature], 0.0);
+    rep (level, level_count [feature]) {
+      log_gammas [feature] [level] = log (gammas.Get (feature, level));
+    }
+  }
+  gradients.assign (max (thread_count, 1u), grad_sq_sum);
+
+  vector <uint> order (match_count);
+  rep (ii, match_count) order [ii] = ii;
+
+  Gammas best = gammas;
+  double best_ll = LogLikelihood (validation);
+  uint bad_epochs = 0;
+  cerr << "Begin validation LL: " << best_ll << endl;
+
+  rep (epoch, max_epochs) {
+    // Fisher-Yates shuffle.
+    for (uint ii = match_count; ii > 1; ii--) {
+      uint jj = min (uint (random.NextDouble (ii)), ii - 1);
+      swap (order [ii - 1], order [jj]);
+    }
+
+    double train_ll = 0.0;
+    for (uint begin = 0; begin < match_count; begin += batch_size) {
+      uint count = min (batch_size, match_count - begin);
+      vector <double> lls (gradients.size (), 0.0);
+      RunParallel (bind (&BtModel::GradientSlice, this,
+                         &order [begin], count, &lls, placeholders::_1));
+      rep (ii, lls.size ()) train_ll += lls [ii];
+
+      double prior_share = double (count) / match_count;
+      rep (feature, feature_count) {
+        rep (level, level_count [feature]) {
+          double g = 0.0;
+          rep (ii, gradients.size ()) {
+            g += gradients [ii] [feature] [level];
+            gradients [ii] [feature] [level] = 0.0;
+          }
+          // prior: prior_games / 2 wins and losses against gamma 1.0
+          double gamma = gammas.Get (feature, level);
+          g += prior_share * prior_games * (0.5 - gamma / (gamma + 1.0));
+          g /= count;
+          if (g == 0.0) continue;
+
+          grad_sq_sum [feature] [level] += g * g;
+          double& lg = log_gammas [feature] [level];
+          lg += learning_rate * g / sqrt (grad_sq_sum [feature] [level]);
+          gammas.Set (feature, level, exp (lg));
+        }
+      }
+    }
+
+    gammas.Normalize ();
+    rep (feature, feature_count) {
+      rep (level, level_count [feature]) {
+        log_gammas [feature] [level] = log (gammas.Get (feature, level));
+      }
+    }
+
+    double valid_ll = LogLikelihood (validation);
+    cerr
+      << "Epoch " << epoch
+      << " train LL = " << train_ll / match_count
+      << "; validation LL = " << valid_ll << endl;
+
+    if (valid_ll > best_ll) {
+      best_ll = valid_ll;
+      best = gammas;
+      bad_epochs = 0;
+    } else {
+      bad_epochs += 1;
+      if (bad_epochs >= patience) break;
+    }
+  }
+
+  gammas = best;
+  gradients.clear ();
+}
+
+void BtModel::GradientSlice (const uint* ids, uint count, vector <double>* lls,
+                             uint thread_no) {
+  uint n = lls->size ();
+  uint begin = SliceBegin (count, thread_no, n);
+  uint end = SliceBegin (count, thread_no + 1, n);
+  (*lls) [thread_no] =
+    matches.AddGradient (gammas, ids + begin, end - begin, &gradients [thread_no]);
+}
+
+// -----------------------------------------------------------------------------
+
+void Test (uint thread_count, bool sgd) {
+  Gammas true_gammas;
+
+  FastRandom rand (123);
+
+  rep (feature, feature_count) {
+    rep (level, level_count[feature]) {
+      true_gammas.Set (feature, level, exp (rand.NextDouble (6)));
+    }
+  }
+
+  true_gammas.Normalize ();
+
+  BtModel model;
+  model.thread_count = thread_count;
+  rep (ii, 200000) {
+    model.matches.NewMatch ();
+    rep (jj, 200) { // TODO randomize team number
+      model.matches.NewTeam ();
+      rep (feature, feature_count) {
+        uint level = rand.GetNextUint (level_count[feature]);
+        model.matches.SetFeatureLevel (feature, level);
+      }
+    }
+    model.matches.SetRandomWinner (true_gammas, rand);
+    //cerr << ii << ": " << model.matches.ToString (ii) << endl;
+  }
+
+  if (sgd) {
+    model.HoldOut (0.1);
+    model.PreprocessData ();
+    model.TrainSgd (100, 1024, 0.5);
+    cerr
+      << true_gammas.Distance (model.gammas)
+      << " / " <<  model.LogLikelihood() << endl;
+    return;
+  }
+
+  model.PreprocessData ();
+  cerr
+    << endl << "---------------------------------" << endl
+    << true_gammas.Distance (model.gammas)
+    << " / " <<  model.LogLikelihood() << endl << endl;
+
+  rep (epoch, 15*feature_count) {
+    model.TrainFeature (epoch % feature_count);
+    cerr
+      << true_gammas.Distance (model.gammas)
+      << " / " <<  model.LogLikelihood() << endl;
+  }
+
+  // // ----------------------
+
+  // model.PreprocessData ();
+  // cerr
+  //   << endl << "---------------------------------" << endl
+  //   << true_gammas.Distance (model.gammas)
+  //   << " / " <<  model.LogLikelihood() << endl;
+
+  // rep (epoch, 20) {
+  //   if (epoch % 10 == 0) cerr << endl;
+  //   model.DoGradientUpdate (100000);
+  //   cerr
+  //     << true_gammas.Distance (model.gammas) << " / "
+  //     << model.LogLikelihood() << endl;
+  // }
+  // cerr << endl;
+
+  // ----------------------
+
+
+  // cerr << endl << "---------------------------------" << endl;
+
+  // model.PreprocessData ();
+  // cerr
+  //   << true_gammas.Distance (model.gammas)
+  //   << " / " <<  model.LogLikelihood() << endl;
+  // rep (epoch, 4) {
+  //   model.DoFullUpdate ();
+  //   cerr
+  //     << true_gammas.Distance (model.gammas)
+  //     << " / " <<  model.LogLikelihood() << endl;
+  // }
+}
+
+// -----------------------------------------------------------------------------
+
+} // namespace
@@ -1,10 +1,23 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#ifndef MM_H_
+#define MM_H_
+
 // TODO player
 // TODO update positive, negatice in gradient descent
-// TODO mini batches
 
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <string>
 #include <vector>
-#include <iomanip>
-using namespace std;
+
+#include "utils.hpp"
+#include "test.hpp"
+#include "fast_random.hpp"
+#include "playout_pool.hpp"
 
 namespace Mm {
 
@@ -21,25 +34,9 @@ const uint level_count [feature_count] = { 2051 };
 // -----------------------------------------------------------------------------
 
 struct Gammas {
-  Gammas () {
-    gammas.resize (feature_count);
-    w.resize (feature_count);
-    rep (feature, feature_count) {
-      gammas [feature].resize (level_count [feature]);
-      w [feature].resize (level_count [feature]);
-    }
-    Reset ();
-  }
+  Gammas ();
 
-  void Reset () {
-    rep (feature , feature_count) {
-      rep (level , level_count [feature]) {
-        Set (feature, level, 1.0);
-        w [feature] [level] = 0.0;
-      }
-    }
-    t = 1.5; // TODO parameter
-  }
+  void Reset ();
 
   double Get (uint feature, uint level) const {
     ASSERT (feature < feature_count);
@@ -60,47 +57,9 @@ struct Gammas {
     gammas [feature] [level] = value;
   }
 
-  void Normalize () {
-    rep (feature, feature_count) {
-      double log_sum = 1.0;
-      double n = 0.0;
-      rep (level, level_count [feature]) {
-        log_sum += log (Get (feature, level));
-        n += 1.0;
-      }
-
-      double mul = exp (log_sum / n);
-
-      rep (level, level_count [feature]) {
-        gammas [feature] [level] /= mul;
-      }
-    }
-  }
-
-  double Distance (const Gammas& other) {
-    double sum = 0.0;
-
-    rep (feature , feature_count) {
-      rep (level , level_count [feature]) {
-        double d = log (Get (feature, level) / other.Get(feature, level));
-        sum += d*d;
-      }
-    }
-
-    return sqrt(sum);
-  }
-
-  string ToString () {
-    ostringstream out;
-    rep (feature , feature_count) {
-      rep (level , level_count [feature]) {
-        out << setprecision(5) << setw (8) << log (Get (feature, level)) << " ";
-      }
-      out << " | ";
-    }
-    return out.str ();
-  }
-
+  void Normalize ();
+  double Distance (const Gammas& other);
+  string ToString ();
 
   vector <vector <double> > w;
 private:
@@ -110,365 +69,140 @@ private:
 
 // -----------------------------------------------------------------------------
 
-struct Team {
-  Team () {
-    rep (feature, feature_count) {
-      levels [feature] = 0;
-    }
-  }
-
-  void SetFeatureLevel (uint feature, uint level) {
-    CHECK (feature < feature_count);
-    CHECK (level < level_count [feature]);
-    levels [feature] = level;
-  }
-
-  double TeamGamma (const Gammas& gammas) const {
-    double mul = 1.0;
-    rep (feature, feature_count) {
-      mul *= gammas.Get (feature, levels [feature]);
-    }
-    return mul;
-  }
-
-  double IncompleteTeamGamma (const Gammas& gammas, uint skip_feature, double* incomplete) const {
-    double mul = 1.0;
-    rep (feature, feature_count) {
-      if (feature != skip_feature) {
-        mul *= gammas.Get (feature, levels [feature]);
-      }
-    }
-    *incomplete = mul;
-    return mul * gammas.Get (skip_feature, levels [skip_feature]);;
-  }
+// All matches in flat arrays. Teams of a match are contiguous, match ii
+// owns teams [TeamBegin (ii), TeamEnd (ii)) and levels of a team are
+// feature_count consecutive entries, so training passes read memory in
+// order and a range of matches can be processed independently.
+class MatchSet {
+public:
+  MatchSet ();
 
-  double TeamGammaDiff (const Gammas& gammas, uint feature, uint level) const {
-    if (levels [feature] != level)
-      return 0.0;
+  uint MatchCount () const { return winners.size (); }
+  uint TeamCount () const { return team_begin.back (); }
 
-    return
-      TeamGamma (gammas) / gammas.Get (feature, levels [feature]);
-  }
+  uint TeamBegin (uint match) const { return team_begin [match]; }
+  uint TeamEnd (uint match) const { return team_begin [match + 1]; }
+  uint Winner (uint match) const { return winners [match]; } // team index
 
-  void GradientUpdate (Gammas& gammas, double update) {
-    rep (feature, feature_count) {
-      gammas.LambdaUpdate (feature, levels [feature], update);
-    }
+  uint Level (uint team, uint feature) const {
+    return levels [team * feature_count + feature];
   }
 
-  string ToString () {
-    ostringstream out;
-    rep (ii, feature_count) {
-      out << (ii == 0 ? "" : " ") << levels[ii];
-    }
-    return out.str();
-  }
+  void NewMatch ();
 
-  uint levels [feature_count];
-};
+  // Adds a team with all levels 0 to the last match.
+  void NewTeam ();
 
-// -----------------------------------------------------------------------------
+  // Of the last team.
+  void SetFeatureLevel (uint feature, uint level);
+  void SetWinnerLastTeam ();
+  void SetRandomWinner (const Gammas& gammas, FastRandom& random);
 
-struct Match {
+  // Moves all matches of other to the end.
+  void Append (MatchSet& other);
 
-  Team& NewTeam () {
-    teams.resize (teams.size() + 1);
-    return teams.back();
-  }
-
-  void SetWinnerLastTeam () {
-    CHECK (teams.size() > 0);
-    this->winner = teams.size()-1;
-  }
-
-  void SetRandomWinner (const Gammas& gammas, FastRandom& random) {
-    vector <double> team_gammas (teams.size());
-    double sum = 0.0;
-    rep (ii, teams.size()) {
-      team_gammas [ii] = teams [ii].TeamGamma (gammas);
-      sum += team_gammas [ii];
-    }
-    double sample = random.NextDouble (sum);
-    double sum2 = 0.0;
-    rep (ii, teams.size()) {
-      sum2 += team_gammas [ii];
-      if (sum2 >= sample) {
-        winner = ii;
-        break;
-      }
+  double TeamGamma (const Gammas& gammas, uint team) const {
+    double mul = 1.0;
+    rep (feature, feature_count) {
+      mul *= gammas.Get (feature, Level (team, feature));
     }
-    //cerr << "X " << ToString () << " " << sum << " " << sample << endl;
+    return mul;
   }
 
-  double TotalGammaDiff (const Gammas& gammas, uint feature, uint level) {
-    double sum = 0.0;
-    rep (ii, teams.size()) {
-      sum += teams[ii].TeamGammaDiff (gammas, feature, level);
-    }
-    return sum;
-  }
+  double TotalGamma (const Gammas& gammas, uint match) const;
+  double TotalGammaDiff (const Gammas& gammas, uint match,
+                         uint feature, uint level) const;
 
-  double TotalGamma (const Gammas& gammas) {
-    double sum = 0.0;
-    rep (ii, teams.size()) {
-      sum += teams[ii].TeamGamma (gammas);
-    }
-    return sum;
-  }
+  // Sum of log-likelihoods of matches [begin, end).
+  double LogLikelihood (const Gammas& gammas, uint begin, uint end) const;
 
-  string ToString () {
-    ostringstream out;
-    rep (ii, teams.size()) {
-      out << "(" << teams[ii].ToString () << ")" << (winner == ii ? "! " : "  ");
-    }
-    return out.str ();
-  }
+  // Minorization step of MM for matches [begin, end): adds to c_e [level]
+  // the share of every team with this level of the feature, counting
+  // only gammas of the other features (C_ij / E_j in Remi's paper).
+  void AddTeamShares (const Gammas& gammas, uint feature, uint begin, uint end,
+                      vector <double>* c_e) const;
 
-  void GradientUpdate (Gammas& gammas) {
-    // Calculate probabilities
-    double *p = new double[teams.size()];
-    double sum = 0.0;
-    rep (ii, teams.size()) {
-      p [ii] = teams[ii].TeamGamma(gammas);
-      sum += p[ii];
-    }
-    rep (ii, teams.size()) {
-      p[ii] /= sum;
-    }
+  // Adds derivatives of the log-likelihood of matches ids [0, count) by
+  // log-gammas to gradient [feature] [level]. Returns the log-likelihood.
+  double AddGradient (const Gammas& gammas, const uint* ids, uint count,
+                      vector <vector <double> >* gradient) const;
 
-    teams[winner].GradientUpdate (gammas, 1.0); // update +alpha
-    rep (ii, teams.size()) {
-      teams[ii].GradientUpdate (gammas, -p[ii]);
-    }
-	delete[] p;
-  }
+  // Appends a copy of match of other.
+  void CopyMatch (const MatchSet& other, uint match);
 
-  double LogLikelihood (const Gammas& gammas) {
-    return log (teams[winner].TeamGamma (gammas) / TotalGamma (gammas));
-  }
+  string ToString (uint match) const;
 
-  vector <Team> teams;
-  uint winner;
+private:
+  vector <uint> levels;     // feature_count per team
+  vector <uint> team_begin; // MatchCount () + 1 team offsets
+  vector <uint> winners;
 };
 
 // -----------------------------------------------------------------------------
 
 struct BtModel {
-  BtModel () : random(123) {
-    act_match = 0;
-    prior_games = 4.0;
-  }
+  BtModel ();
 
-  Match& NewMatch () {
-    matches.resize (matches.size() + 1);
-    return matches.back();
-  }
+  void PreprocessData ();
 
-  void PreprocessData () {
-    gammas.Reset ();
-    rep (ii, matches.size()) {
-      const Match& match = matches [ii]; 
-      const Team& winner = match.teams [match.winner];
-      
-      rep (feature , feature_count) {
-        uint level = winner.levels [feature];
-        gammas.w [feature] [level] += 1.0;
-      }
-    }
-  }
+  // Replaces validation with a random fraction of matches.
+  void HoldOut (double fraction);
 
   // Batch MM
-  void TrainFeature (uint feature) {
-    vector <double> c_e (level_count [feature]);
-    // prior
-    rep (level, level_count [feature]) {
-      c_e [level] = prior_games / (gammas.Get (feature, level) + 1.0);
-    }
-
-    rep (ii, matches.size ()) {
-      const vector <Team>& teams = matches [ii].teams;
-      
-      // itg = incomplete team gamma (without current feature)
-      double *itg = new double[teams.size()];
-      double tg_sum = 0.0; // E in Remi's paper
-
-      rep (jj, teams.size()) {
-        tg_sum += teams [jj].IncompleteTeamGamma (gammas, feature, & itg[jj]);
-      }
+  void TrainFeature (uint feature);
+  void Train (uint epochs);
 
-      double tg_sum_inv = 1.0 / tg_sum;
-
-      rep (jj, teams.size()) {
-        // level of the updated feature in current team
-        uint level = teams [jj].levels [feature];
-        c_e [level] += itg [jj] * tg_sum_inv;
-      }
-
-	  delete[] itg;
-    }
-
-    rep (level, level_count [feature]) {
-      double new_gamma = (gammas.w [feature] [level] + prior_games / 2) / c_e [level];
-      gammas.Set (feature, level, new_gamma);
-    }
-
-    gammas.Normalize ();
-  }
-
-  void Train (uint epochs) {
-    double ll_improve [feature_count];
-    rep (f, feature_count)  ll_improve [f] = 1000.0;
-
-    double last_ll = LogLikelihood();
-    cerr << "Begin LL: " << last_ll << endl;
-
-    rep (ii, epochs) {
-      uint best_f = 0;
-      rep (f, feature_count) {
-        if (ll_improve[f] > ll_improve[best_f]) {
-          best_f = f;
-        }
-      }
-
-      cerr << "Train feature " << best_f << " ... " << flush;
-      TrainFeature (best_f);
-
-      double new_ll = LogLikelihood();
-      ll_improve [best_f] = new_ll - last_ll;
-      last_ll = new_ll;
-      cerr << "New LL = " << new_ll << "; delta LL = " << ll_improve [best_f] << endl;
-    }
-  }
+  // Mini-batch stochastic gradient ascent on log-gammas with AdaGrad step
+  // sizes. Stops when validation log-likelihood did not improve for
+  // patience epochs and keeps the best gammas. Assumes HoldOut.
+  void TrainSgd (uint max_epochs, uint batch_size, double learning_rate);
 
   // Minorization - Maximization algorithm
-  void UpdateGamma (uint feature, uint level) {
-    
-    // prior
-    double c_e = 2.0 / (gammas.Get (feature, level) + 1.0);
-    
-    rep (ii, matches.size()) {
-      double tgd = matches [ii].TotalGammaDiff (gammas, feature, level);
-      double tg  = matches [ii].TotalGamma (gammas);
-      c_e += tgd / tg;
-    }
-    // + 1.0 is prior
-    double w = gammas.w[feature][level] + 1.0;
-    
-    gammas.Set (feature, level, w / c_e);
-  }
+  void UpdateGamma (uint feature, uint level);
+  void DoFullUpdate ();
 
-  void DoFullUpdate () {
-    rep (feature , feature_count) {
-      rep (level , level_count [feature]) {
-        UpdateGamma (feature, level);
-        //cerr << level << " "  << LogLikelihood() << endl;
+  void GradientUpdate (uint match);
+  void TeamGradientUpdate (uint team, double update);
+  void DoGradientUpdate (uint n);
 
-      }
-    }
-    gammas.Normalize (); 
-  }
-
-  void DoGradientUpdate (uint n) {
-
-    rep (ii, n) {
-      matches [act_match].GradientUpdate (gammas);
-      act_match += 1;
-      if (act_match >= matches.size()) act_match = 0;
-    }
-    gammas.Normalize ();
-  }
-
-  double LogLikelihood () {
-    double sum = 0.0;
-    rep (ii, matches.size ()) {
-      sum += matches[ii].LogLikelihood (gammas);
-    }
-    return sum / matches.size();
-  }
+  // Average over matches.
+  double LogLikelihood ();
+  double LogLikelihood (const MatchSet& set);
 
-  vector <Match> matches;
+  MatchSet matches;
+  MatchSet validation;
   uint act_match;
   Gammas gammas;
   FastRandom random;
   double prior_games;
+  uint thread_count;
+  uint patience;
+
+private:
+  // Runs work (thread_no) on thread_count threads, waits for all.
+  // The threads are created on the first call and kept.
+  void RunParallel (const function <void (uint)>& work);
+
+  // Start of slice ii when [0, size) is cut into n equal slices.
+  static uint SliceBegin (uint size, uint ii, uint n);
+
+  void AddTeamSharesSlice (uint feature, vector <vector <double> >* c_e,
+                           uint thread_no);
+  void LogLikelihoodSlice (const MatchSet* set, vector <double>* sums,
+                           uint thread_no);
+  void GradientSlice (const uint* ids, uint count, vector <double>* lls,
+                      uint thread_no);
+
+  vector <double> p; // scratch of GradientUpdate
+  vector <vector <vector <double> > > gradients; // per thread
+  std::unique_ptr <PlayoutPool> workers;
 };
 
 // -----------------------------------------------------------------------------
 
-void Test () {
-  Gammas true_gammas;
-
-  FastRandom rand (123);
-
-  rep (feature, feature_count) {
-    rep (level, level_count[feature]) {
-      true_gammas.Set (feature, level, exp (rand.NextDouble (6)));
-    }
-  }
-  
-  true_gammas.Normalize (); 
-
-  BtModel model;
-  rep (ii, 200000) {
-    Match& match = model.NewMatch ();
-    rep (jj, 200) { // TODO randomize team number
-      Team& team = match.NewTeam ();
-      rep (feature, feature_count) {
-        uint level = rand.GetNextUint (level_count[feature]);
-        team.SetFeatureLevel (feature, level);
-      }
-    }
-    match.SetRandomWinner (true_gammas, rand);
-    //cerr << ii << ": " << match.ToString () << endl;
-  }
-
-  model.PreprocessData ();
-  cerr
-    << endl << "---------------------------------" << endl
-    << true_gammas.Distance (model.gammas)
-    << " / " <<  model.LogLikelihood() << endl << endl;
-
-  rep (epoch, 15*feature_count) {
-    model.TrainFeature (epoch % feature_count);
-    cerr
-      << true_gammas.Distance (model.gammas)
-      << " / " <<  model.LogLikelihood() << endl;
-  }
-
-  // // ----------------------
-
-  // model.PreprocessData ();
-  // cerr
-  //   << endl << "---------------------------------" << endl
-  //   << true_gammas.Distance (model.gammas)
-  //   << " / " <<  model.LogLikelihood() << endl;
-
-  // rep (epoch, 20) {
-  //   if (epoch % 10 == 0) cerr << endl;
-  //   model.DoGradientUpdate (100000);
-  //   cerr
-  //     << true_gammas.Distance (model.gammas) << " / "
-  //     << model.LogLikelihood() << endl;
-  // }
-  // cerr << endl;
-
-  // ----------------------
-
-
-  // cerr << endl << "---------------------------------" << endl;
-
-  // model.PreprocessData ();
-  // cerr
-  //   << true_gammas.Distance (model.gammas)
-  //   << " / " <<  model.LogLikelihood() << endl;
-  // rep (epoch, 4) {
-  //   model.DoFullUpdate ();
-  //   cerr
-  //     << true_gammas.Distance (model.gammas)
-  //     << " / " <<  model.LogLikelihood() << endl;
-  // }
-}
-
-// -----------------------------------------------------------------------------
+// Fits gammas to matches generated from random true gammas.
+void Test (uint thread_count, bool sgd);
 
 } // namespace
+
+#endif
@@ -3,28 +3,35 @@
 
 #include "utils.hpp"
 
+// Search settings. Every Engine owns its own copy, so engines with
+// different settings can live in one process.
 class Param {
 public:
-  static float genmove_playouts;
-  static bool  use_local;
-
-  static bool  tree_use;
-  static uint  tree_max_moves;
-  static float tree_explore_coeff;
-  static bool  tree_rave_update;
-  static bool  tree_rave_use;
-  static float tree_stat_bias;
-  static float tree_rave_bias;
-  static float tree_progressive_bias;
-  static float tree_progressive_bias_prior;
-  static float tree_rave_update_fraction;
-
-  static float prior_update_count;
-  static float prior_mean;
-
-  static float mature_update_count;
-
-  static float resign_mean;
+  Param ();
+
+  float genmove_playouts;
+  bool  use_local;
+
+  bool  tree_use;
+  uint  tree_max_moves;
+  float tree_explore_coeff;
+  bool  tree_rave_update;
+  bool  tree_rave_use;
+  float tree_stat_bias;
+  float tree_rave_bias;
+  float tree_progressive_bias;
+  float tree_progressive_bias_prior;
+  float tree_rave_update_fraction;
+
+  float prior_update_count;
+  float prior_mean;
+
+  float mature_update_count;
+
+  float resign_mean;
+
+  uint  ownership_playouts;  // minimal sample for territory estimates
+  uint  ownership_threads;   // 0 means one per core
 };
 
 #endif /* GO_PARAM_H */
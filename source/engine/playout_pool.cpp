@@ -0,0 +1,102 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#include "playout_pool.hpp"
+#include "engine.hpp"
+
+const uint PlayoutPool::kSlice;
+
+// Either playouts of an engine or a single task.
+struct PlayoutPool::Request {
+  Engine* engine;
+  const std::function <void (uint)>* task;
+  uint task_index;
+  uint playouts_left;   // 1 for a task not yet done
+};
+
+
+PlayoutPool::PlayoutPool (uint thread_count) : stopping (false) {
+  if (thread_count == 0) thread_count = std::thread::hardware_concurrency ();
+  if (thread_count == 0) thread_count = 1;
+  rep (ii, thread_count) {
+    workers.push_back (std::thread (&PlayoutPool::WorkerLoop, this));
+  }
+}
+
+
+PlayoutPool::~PlayoutPool () {
+  {
+    std::unique_lock <std::mutex> lock (mutex);
+    stopping = true;
+  }
+  work_ready.notify_all ();
+  rep (ii, workers.size ()) workers [ii].join ();
+}
+
+
+uint PlayoutPool::ThreadCount () const {
+  return workers.size ();
+}
+
+
+void PlayoutPool::DoNPlayouts (Engine& engine, uint n) {
+  if (n == 0) return;
+  Request request;
+  request.engine = &engine;
+  request.task = NULL;
+  request.task_index = 0;
+  request.playouts_left = n;
+
+  std::unique_lock <std::mutex> lock (mutex);
+  queue.push_back (&request);
+  work_ready.notify_one ();
+  while (request.playouts_left > 0) work_done.wait (lock);
+}
+
+
+void PlayoutPool::Run (uint task_count, const std::function <void (uint)>& task) {
+  vector <Request> requests (task_count);
+  std::unique_lock <std::mutex> lock (mutex);
+  rep (ii, task_count) {
+    requests [ii].engine = NULL;
+    requests [ii].task = &task;
+    requests [ii].task_index = ii;
+    requests [ii].playouts_left = 1;
+    queue.push_back (&requests [ii]);
+  }
+  work_ready.notify_all ();
+  rep (ii, task_count) {
+    while (requests [ii].playouts_left > 0) work_done.wait (lock);
+  }
+}
+
+
+void PlayoutPool::WorkerLoop () {
+  std::unique_lock <std::mutex> lock (mutex);
+  while (true) {
+    while (queue.empty () && !stopping) work_ready.wait (lock);
+    if (queue.empty ()) return;
+
+    Request* request = queue.front ();
+    queue.pop_front ();
+    uint n = request->engine != NULL ? min (kSlice, request->playouts_left) : 1;
+
+    lock.unlock ();
+    if (request->engine != NULL) {
+      TRACE_SPAN ("PlayoutSlice");
+      rep (ii, n) request->engine->DoOnePlayout (true, true);
+    } else {
+      (*request->task) (request->task_index);
+    }
+    lock.lock ();
+
+    request->playouts_left -= n;
+    if (request->playouts_left > 0) {
+      queue.push_back (request);
+      work_ready.notify_one ();
+    } else {
+      work_done.notify_all ();
+    }
+  }
+}
@@ -0,0 +1,52 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#ifndef PLAYOUT_POOL_H_
+#define PLAYOUT_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "utils.hpp"
+
+class Engine;
+
+// Worker threads shared by many engines.
+// Requests are served round-robin, kSlice playouts at a time, so one long
+// search does not starve the others. An engine is never run by two
+// workers at once.
+class PlayoutPool {
+public:
+  explicit PlayoutPool (uint thread_count);
+  ~PlayoutPool ();
+
+  // Runs n playouts of the engine and blocks until they are done.
+  void DoNPlayouts (Engine& engine, uint n);
+
+  // Runs task (ii) for every ii < task_count, in parallel with each
+  // other and with the playouts, and blocks until all are done.
+  void Run (uint task_count, const std::function <void (uint)>& task);
+
+  uint ThreadCount () const;
+
+  static const uint kSlice = 64;
+
+private:
+  struct Request;
+
+  void WorkerLoop ();
+
+  std::mutex mutex;
+  std::condition_variable work_ready;
+  std::condition_variable work_done;
+  std::deque <Request*> queue;
+  std::vector <std::thread> workers;
+  bool stopping;
+};
+
+#endif
@@ -0,0 +1,134 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#include <iomanip>
+#include <sstream>
+
+#include "search_profile.hpp"
+
+const uint SearchProfile::kLengthBucket;
+const uint SearchProfile::kLengthBuckets;
+
+
+SearchProfile::SearchProfile () {
+  Reset ();
+}
+
+
+void SearchProfile::Reset () {
+  last_mark = FastTimer::GetCcTime ();
+  rep (ii, kPhaseCount) cycles [ii] = 0.0;
+  playout_count = 0;
+  expansion_count = 0;
+  node_count = 0;
+  depth_sum = 0;
+  max_depth = 0;
+  length_sum = 0;
+  rep (ii, kLengthBuckets) length_histogram [ii] = 0;
+  seconds = 0.0;
+}
+
+
+void SearchProfile::SetSeconds (double new_seconds) {
+  seconds = new_seconds;
+}
+
+
+void SearchProfile::Mark () {
+  last_mark = FastTimer::GetCcTime ();
+}
+
+
+void SearchProfile::Charge (Phase phase) {
+  uint64 now = FastTimer::GetCcTime ();
+  cycles [phase] += double (now - last_mark);
+  last_mark = now;
+}
+
+
+void SearchProfile::AddExpansion (uint new_node_count) {
+  expansion_count += 1;
+  node_count += new_node_count;
+}
+
+
+void SearchProfile::AddPlayout (uint tree_depth, uint length) {
+  playout_count += 1;
+  depth_sum += tree_depth;
+  max_depth = max (max_depth, tree_depth);
+  length_sum += length;
+  length_histogram [min (length / kLengthBucket, kLengthBuckets - 1)] += 1;
+}
+
+
+uint64 SearchProfile::PlayoutCount () const {
+  return playout_count;
+}
+
+
+uint64 SearchProfile::ExpansionCount () const {
+  return expansion_count;
+}
+
+
+uint64 SearchProfile::NodeCount () const {
+  return node_count;
+}
+
+
+double SearchProfile::MeanDepth () const {
+  return playout_count > 0 ? double (depth_sum) / playout_count : 0.0;
+}
+
+
+uint SearchProfile::MaxDepth () const {
+  return max_depth;
+}
+
+
+string SearchProfile::ToString () const {
+  const char* names [kPhaseCount] =
+    { "setup", "descent", "expansion", "playout", "scoring", "backup" };
+
+  ostringstream out;
+  double total = 0.0;
+  rep (ii, kPhaseCount) total += cycles [ii];
+  double playouts = max<double> (playout_count, 1);
+
+  out << fixed << setprecision (1)
+      << playout_count << " playouts in " << seconds << " s, "
+      << expansion_count << " expansions";
+  if (seconds > 0.0) out << " (" << expansion_count / seconds << " per s)";
+  out << endl;
+#ifdef SEARCH_PROFILE
+  out << "phase        Mcycles   share  cycles/playout" << endl;
+  rep (ii, kPhaseCount) {
+    out << setw (10) << left << names [ii] << right
+        << setw (10) << cycles [ii] / 1e6
+        << setw (7) << (total > 0.0 ? 100.0 * cycles [ii] / total : 0.0) << "%"
+        << setw (16) << cycles [ii] / playouts << endl;
+  }
+#else
+  unused (names);
+  unused (total);
+  out << "phase cycles: compiled without SEARCH_PROFILE" << endl;
+#endif
+  out << "tree depth: mean " << depth_sum / playouts
+      << ", max " << max_depth << endl
+      << "playout length: mean " << length_sum / playouts << endl;
+  rep (ii, kLengthBuckets) {
+    if (length_histogram [ii] == 0) continue;
+    uint low = ii * kLengthBucket;
+    out << setw (5) << low;
+    if (ii + 1 < kLengthBuckets) {
+      out << " .. " << setw (3) << low + kLengthBucket - 1;
+    } else {
+      out << " ..    ";
+    }
+    out << setw (8) << length_histogram [ii]
+        << " " << string (uint (50.0 * length_histogram [ii] / playouts), '#')
+        << endl;
+  }
+  return out.str ();
+}
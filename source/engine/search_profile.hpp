@@ -0,0 +1,66 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#ifndef SEARCH_PROFILE_H_
+#define SEARCH_PROFILE_H_
+
+#include <string>
+
+#include "utils.hpp"
+#include "fast_timer.hpp"
+
+// Time and counts of the phases of DoOnePlayout.
+// Cycles are charged at phase boundaries only (per move in the tree,
+// once for the whole random part), so the cost is a few rdtsc per playout.
+// Cycle collection is compiled in when SEARCH_PROFILE is defined (CMake
+// option); the counts are always kept, they also feed the stats command.
+class SearchProfile {
+public:
+  enum Phase { Setup, Descent, Expansion, Playout, Scoring, Backup, kPhaseCount };
+
+  SearchProfile ();
+
+  // Clears statistics, e.g. at the beginning of a genmove.
+  void Reset ();
+  void SetSeconds (double seconds);
+
+  // Starts timing at the beginning of a playout.
+  void Mark ();
+  // Adds cycles since the last Mark or Charge to the phase.
+  void Charge (Phase phase);
+
+  void AddExpansion (uint node_count);
+  void AddPlayout (uint tree_depth, uint length);
+
+  uint64 PlayoutCount () const;
+  uint64 ExpansionCount () const;
+  uint64 NodeCount () const;   // created by expansions
+  double MeanDepth () const;
+  uint MaxDepth () const;
+
+  std::string ToString () const;
+
+private:
+  static const uint kLengthBucket = 20;
+  static const uint kLengthBuckets = 20;
+
+  uint64 last_mark;
+  double cycles [kPhaseCount];
+  uint64 playout_count;
+  uint64 expansion_count;
+  uint64 node_count;
+  uint64 depth_sum;
+  uint max_depth;
+  uint64 length_sum;
+  uint64 length_histogram [kLengthBuckets];  // the last one is open
+  double seconds;
+};
+
+#ifdef SEARCH_PROFILE
+#define SEARCH_PROFILE_DO(statement) statement
+#else
+#define SEARCH_PROFILE_DO(statement)
+#endif
+
+#endif
@@ -0,0 +1,189 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+#include "selfplay.hpp"
+
+struct SelfPlay::Shared {
+  uint game_count;
+  uint playouts;
+  GameCorpus::Writer* writer;
+  std::atomic <uint> next;
+
+  // Guards writer and stats.
+  std::mutex mutex;
+  Stats stats;
+};
+
+
+SelfPlay::SelfPlay (Gtp::ReplWithGogui& gtp, const Gammas& gammas, Engine& engine)
+  : gammas (gammas), engine (engine)
+{
+  gtp.Register ("selfplay", this, &SelfPlay::CSelfPlay);
+}
+
+
+string SelfPlay::Stats::ToString () const {
+  ostringstream out;
+  out << fixed << setprecision (1)
+      << game_count << " games, " << move_count << " moves, "
+      << double (move_count) / max (game_count, 1u) << " moves/game" << endl
+      << degenerate_count << " degenerate (shorter than " << kMinMoves
+      << " moves, not written), "
+      << forced_count << " passes replaced by a policy move" << endl
+      << "black wins " << 100.0 * black_wins / max (game_count, 1u) << "%, "
+      << resign_count << " resigned" << endl
+      << seconds << " s, "
+      << game_count * 3600.0 / max (seconds, 1e-9) << " games/hour";
+  return out.str ();
+}
+
+
+bool SelfPlay::Run (uint game_count, uint playouts, uint thread_count,
+                    GameCorpus::Writer* writer, Stats* stats)
+{
+  Shared shared;
+  shared.game_count = game_count;
+  shared.playouts = playouts;
+  shared.writer = writer;
+  shared.next = 0;
+  shared.stats.game_count = 0;
+  shared.stats.degenerate_count = 0;
+  shared.stats.forced_count = 0;
+  shared.stats.move_count = 0;
+  shared.stats.black_wins = 0;
+  shared.stats.resign_count = 0;
+
+  chrono::steady_clock::time_point begin = chrono::steady_clock::now ();
+  vector <thread> threads;
+  rep (ii, thread_count) {
+    threads.push_back (thread (&SelfPlay::Worker, this, &shared));
+  }
+  rep (ii, threads.size ()) threads [ii].join ();
+
+  *stats = shared.stats;
+  stats->seconds = chrono::duration <double> (chrono::steady_clock::now () - begin).count ();
+  return writer->Close ();
+}
+
+
+void SelfPlay::Worker (Shared* shared) {
+  Engine* worker = new Engine (gammas);
+  worker->GetParam () = engine.GetParam ();
+  worker->GetParam ().genmove_playouts = shared->playouts;
+  worker->SetQuiet (true);
+
+  FastRandom random (TimeSeed ());
+  vector <Move> moves;
+  while (shared->next.fetch_add (1) < shared->game_count) {
+    bool resigned;
+    uint forced_count;
+    Player winner = PlayGame (*worker, random, &moves, &resigned, &forced_count);
+
+    lock_guard <mutex> lock (shared->mutex);
+    Stats& stats = shared->stats;
+    stats.forced_count += forced_count;
+    if (moves.size () < kMinMoves) {
+      stats.degenerate_count += 1;
+      LOG (Log::Info, "selfplay: degenerate game of " << moves.size () << " moves");
+      continue;
+    }
+    shared->writer->Add (moves);
+    stats.game_count += 1;
+    stats.move_count += moves.size ();
+    if (winner == Player::Black ()) stats.black_wins += 1;
+    if (resigned) stats.resign_count += 1;
+    LOG (Log::Info, "selfplay: game " << stats.game_count << "/"
+         << shared->game_count << ", " << moves.size () << " moves");
+  }
+
+  delete worker;
+}
+
+
+Player SelfPlay::PlayGame (Engine& worker, FastRandom& random,
+                           vector <Move>* moves, bool* resigned, uint* forced_count)
+{
+  CHECK (worker.Reset (board_size));
+  moves->clear ();
+  *resigned = false;
+  *forced_count = 0;
+
+  const Board& board = worker.GetBoard ();
+  while (!board.BothPlayerPass () && moves->size () < 3 * Board::kArea) {
+    Player pl = board.ActPlayer ();
+    Move m = worker.Genmove (pl);
+    if (!m.IsValid ()) {
+      *resigned = true;
+      return pl.Other ();
+    }
+    if (m.GetVertex () == Vertex::Pass ()) {
+      CHECK (worker.Undo ());
+      Move policy = PolicyMove (board, random);
+      if (policy.GetVertex () != Vertex::Pass ()) *forced_count += 1;
+      CHECK (worker.Play (policy));
+      m = policy;
+    }
+    moves->push_back (m);
+  }
+  return board.TrompTaylorWinner ();
+}
+
+
+Move SelfPlay::PolicyMove (const Board& board, FastRandom& random) {
+  Player pl = board.ActPlayer ();
+  vector <Vertex> candidates;
+  rep (ii, board.EmptyVertexCount ()) {
+    Vertex v = board.EmptyVertex (ii);
+    if (board.IsReallyLegal (Move (pl, v)) && !board.IsEyelike (pl, v)) {
+      candidates.push_back (v);
+    }
+  }
+  if (candidates.empty ()) return Move (pl, Vertex::Pass ());
+
+  // The sampler knows only simple ko, superko is checked here.
+  Sampler sampler (board, gammas);
+  sampler.NewPlayout ();
+  rep (ii, 10) {
+    Vertex v = sampler.SampleMove (random);
+    if (find (candidates.begin (), candidates.end (), v) != candidates.end ()) {
+      return Move (pl, v);
+    }
+  }
+  return Move (pl, candidates [random.GetNextUint (candidates.size ())]);
+}
+
+
+// Usage: selfplay corpus_file game_count [playouts] [threads]
+// 0 threads means one per core.
+void SelfPlay::CSelfPlay (Gtp::Io& io) {
+  string file_name = io.Read <string> ();
+  uint game_count = io.Read <uint> ();
+  uint playouts = io.Read <uint> (1000);
+  uint thread_count = io.Read <uint> (0);
+  io.CheckEmpty ();
+
+  if (thread_count == 0) thread_count = max (thread::hardware_concurrency (), 1u);
+  if (playouts == 0) {
+    io.SetError ("playouts must be positive");
+    return;
+  }
+
+  GameCorpus::Writer writer;
+  if (!writer.Open (file_name)) {
+    io.SetError ("Can't open a file: " + file_name);
+    return;
+  }
+  Stats stats;
+  if (!Run (game_count, playouts, thread_count, &writer, &stats)) {
+    io.SetError ("Can't write a file: " + file_name);
+    return;
+  }
+  io.out << stats.ToString ();
+}
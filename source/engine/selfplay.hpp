@@ -0,0 +1,63 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#ifndef SELFPLAY_H_
+#define SELFPLAY_H_
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "gtp_gogui.hpp"
+#include "engine.hpp"
+
+// Self-play games written to a game corpus (see game_corpus.hpp) for MM
+// training. Games run concurrently, each thread with its own engine, and
+// every move is a genmove with a fixed playout budget. A pass is replaced
+// by a move of the playout policy while the player has a legal move that
+// does not fill an eye, so a game ends with two passes on a settled board,
+// a resignation or after 3 * Board::kArea moves. Games shorter than
+// kMinMoves are counted as degenerate and not written.
+class SelfPlay {
+public:
+  // New engines copy their settings from the given one.
+  SelfPlay (Gtp::ReplWithGogui& gtp, const Gammas& gammas, Engine& engine);
+
+  static const uint kMinMoves = Board::kArea / 4;
+
+  struct Stats {
+    uint game_count;   // written
+    uint degenerate_count;
+    uint forced_count; // passes replaced by a policy move
+    uint64 move_count;
+    uint black_wins;   // by resignation or TrompTaylorWinner
+    uint resign_count;
+    double seconds;
+
+    std::string ToString () const;
+  };
+
+  // Plays game_count games on thread_count threads. Returns false if the
+  // corpus can't be written.
+  bool Run (uint game_count, uint playouts, uint thread_count,
+            GameCorpus::Writer* writer, Stats* stats);
+
+private:
+  struct Shared;
+
+  void Worker (Shared* shared);
+  // Returns the winner. Sets forced_count.
+  Player PlayGame (Engine& worker, FastRandom& random,
+                   std::vector <Move>* moves, bool* resigned, uint* forced_count);
+  // A legal move of the player to move, not filling an eye, drawn from
+  // the playout policy. Pass if there is none.
+  Move PolicyMove (const Board& board, FastRandom& random);
+  void CSelfPlay (Gtp::Io& io);
+
+  const Gammas& gammas;
+  Engine& engine;
+};
+
+#endif
@@ -0,0 +1,328 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "server.hpp"
+#include "engine.hpp"
+#include "mcts_gtp.hpp"
+#include "playout_pool.hpp"
+
+// -----------------------------------------------------------------------------
+
+// Serializes whole responses written to one file descriptor.
+class Server::Output {
+public:
+  explicit Output (int fd) : fd (fd) {
+  }
+
+  void Write (const string& s) {
+    std::lock_guard <std::mutex> lock (mutex);
+    const char* data = s.data ();
+    size_t left = s.size ();
+    while (left > 0) {
+      ssize_t n = write (fd, data, left);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) return;
+      data += n;
+      left -= n;
+    }
+  }
+
+private:
+  int fd;
+  std::mutex mutex;
+};
+
+// -----------------------------------------------------------------------------
+
+// One engine with its own GTP repl and a thread executing its commands.
+class Server::Session {
+public:
+  Session (const string& name,
+           const Gammas& gammas,
+           PlayoutPool& pool,
+           Output& output) :
+    name (name),
+    engine (gammas),
+    mcts_gtp (gtp, engine),
+    output (output),
+    closing (false),
+    done (false)
+  {
+    gtp.RegisterStatic ("name", "Libego");
+    gtp.RegisterStatic ("protocol_version", "2");
+    engine.SetPlayoutPool (&pool);
+    worker = std::thread (&Session::Loop, this);
+  }
+
+  // Finishes already pushed commands.
+  ~Session () {
+    {
+      std::lock_guard <std::mutex> lock (mutex);
+      closing = true;
+    }
+    ready.notify_one ();
+    worker.join ();
+  }
+
+  // True when the worker thread has finished (after "quit").
+  bool IsDone () {
+    std::lock_guard <std::mutex> lock (mutex);
+    return done;
+  }
+
+  // Engine stats as of at most a second ago, also during a search.
+  string LiveStats () const {
+    return engine.LiveStatsToString ();
+  }
+
+  void Push (const string& command) {
+    {
+      std::lock_guard <std::mutex> lock (mutex);
+      commands.push_back (command);
+    }
+    ready.notify_one ();
+  }
+
+private:
+  void Loop () {
+    while (true) {
+      string command;
+      {
+        std::unique_lock <std::mutex> lock (mutex);
+        while (commands.empty () && !closing) ready.wait (lock);
+        if (commands.empty ()) return;
+        command = commands.front ();
+        commands.pop_front ();
+      }
+
+      string report;
+      Gtp::Repl::Status status = gtp.RunOneCommand (command, &report);
+      if (status == Gtp::Repl::NoOp) continue;
+
+      output.Write (name + " " +
+                    (status == Gtp::Repl::Failure ? "?" : "=") + " " +
+                    report + "\n\n");
+
+      if (status == Gtp::Repl::Quit) {
+        std::lock_guard <std::mutex> lock (mutex);
+        done = true;
+        return;
+      }
+    }
+  }
+
+  const string name;
+  Gtp::ReplWithGogui gtp;
+  Engine engine;
+  MctsGtp mcts_gtp;
+  Output& output;
+
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::deque <string> commands;
+  bool closing;
+  bool done;
+  std::thread worker;
+};
+
+// -----------------------------------------------------------------------------
+
+namespace {
+  // True for "name" and "<id> name" without arguments.
+  bool IsBareCommand (const string& command, const string& name) {
+    istringstream in (command);
+    string word;
+    in >> word;
+    if (word != "" && isdigit (word [0])) in >> word;
+    string rest;
+    return word == name && !(in >> rest);
+  }
+
+  // True for "quit" and "<id> quit".
+  bool IsQuit (const string& command) {
+    istringstream in (command);
+    string word;
+    in >> word;
+    if (word != "" && isdigit (word [0])) in >> word;
+    return word == "quit";
+  }
+
+  // Reads one line from fd, buffer keeps what was read past the newline.
+  bool ReadLine (int fd, string* buffer, string* line) {
+    while (true) {
+      size_t end = buffer->find ('\n');
+      if (end != string::npos) {
+        *line = buffer->substr (0, end);
+        buffer->erase (0, end + 1);
+        return true;
+      }
+      char chunk [4096];
+      ssize_t n = read (fd, chunk, sizeof (chunk));
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) {
+        if (buffer->empty ()) return false;
+        *line = *buffer;
+        buffer->clear ();
+        return true;
+      }
+      buffer->append (chunk, n);
+    }
+  }
+}
+
+
+Server::Server (Gtp::ReplWithGogui& gtp, const Gammas& gammas) : gammas (gammas) {
+  gtp.Register ("server", this, &Server::CServer);
+}
+
+
+void Server::Serve (PlayoutPool& pool, int in_fd, int out_fd) {
+  Output output (out_fd);
+  map <string, Session*> sessions;
+  vector <Session*> finished;
+
+  string buffer;
+  string line;
+  while (ReadLine (in_fd, &buffer, &line)) {
+    istringstream in (line);
+    string name;
+    if (!(in >> name) || name [0] == '#') continue;
+    string command;
+    getline (in, command);
+
+    Session*& session = sessions [name];
+    if (session == NULL) {
+      session = new Session (name, gammas, pool, output);
+    }
+
+    // Answered at once, not after the queued commands, so a client can
+    // watch a running genmove.
+    if (IsBareCommand (command, "stats")) {
+      output.Write (name + " = \n" + session->LiveStats () + "\n\n");
+      continue;
+    }
+    session->Push (command);
+
+    // Next command with this name opens a new session.
+    if (IsQuit (command)) {
+      finished.push_back (session);
+      sessions.erase (name);
+    }
+
+    // Free engines of sessions that already quit.
+    uint ii = 0;
+    while (ii < finished.size ()) {
+      if (finished [ii]->IsDone ()) {
+        delete finished [ii];
+        finished [ii] = finished.back ();
+        finished.pop_back ();
+      } else {
+        ii += 1;
+      }
+    }
+  }
+
+  rep (ii, finished.size ()) delete finished [ii];
+
+  for (map <string, Session*>::iterator it = sessions.begin ();
+       it != sessions.end ();
+       ++it)
+  {
+    delete it->second;
+  }
+}
+
+
+bool Server::Listen (PlayoutPool& pool, const string& socket_path) {
+  sockaddr_un addr;
+  if (socket_path.size () >= sizeof (addr.sun_path)) return false;
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  strcpy (addr.sun_path, socket_path.c_str ());
+
+  int listen_fd = socket (AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd < 0) return false;
+  unlink (socket_path.c_str ());
+  if (bind (listen_fd, (sockaddr*) &addr, sizeof (addr)) != 0 ||
+      listen (listen_fd, 64) != 0) {
+    close (listen_fd);
+    return false;
+  }
+
+  // A client that goes away should not kill the whole server.
+  signal (SIGPIPE, SIG_IGN);
+
+  vector <Connection*> connections;
+  while (true) {
+    int fd = accept (listen_fd, NULL, NULL);
+    if (fd < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+
+    // Joins threads of clients that went away.
+    uint ii = 0;
+    while (ii < connections.size ()) {
+      if (connections [ii]->done.load ()) {
+        connections [ii]->thread.join ();
+        delete connections [ii];
+        connections [ii] = connections.back ();
+        connections.pop_back ();
+      } else {
+        ii += 1;
+      }
+    }
+
+    Connection* connection = new Connection;
+    connection->done = false;
+    connection->thread =
+      std::thread (&Server::ServeConnection, this, &pool, fd, connection);
+    connections.push_back (connection);
+  }
+
+  rep (ii, connections.size ()) {
+    connections [ii]->thread.join ();
+    delete connections [ii];
+  }
+  close (listen_fd);
+  return false;
+}
+
+
+void Server::ServeConnection (PlayoutPool* pool, int fd, Connection* connection) {
+  Serve (*pool, fd, fd);
+  close (fd);
+  connection->done = true;
+}
+
+
+void Server::CServer (Gtp::Io& io) {
+  uint thread_count = io.Read <uint> (0);
+  string socket_path = io.Read <string> ("");
+  io.CheckEmpty ();
+
+  PlayoutPool pool (thread_count);
+  LOG (Log::Info, "Server with " << pool.ThreadCount () << " playout threads");
+
+  if (socket_path == "") {
+    Serve (pool, 0, 1);
+    return;
+  }
+
+  if (!Listen (pool, socket_path)) {
+    io.SetError ("can't listen on: " + socket_path);
+  }
+}
@@ -0,0 +1,58 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#ifndef SERVER_H_
+#define SERVER_H_
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "gtp_gogui.hpp"
+#include "ego.hpp"
+
+class PlayoutPool;
+
+// Hosts many independent engine sessions in one process.
+// Sessions share the read-only gammas and one PlayoutPool. Each session
+// has its own Engine, settings and set of GTP commands.
+//
+// Every input line is "<session> <gtp command>". A session is created by
+// its first command and closed by "quit". Responses are GTP responses
+// prefixed with the session name: "<session> = ..." or "<session> ? ...".
+// Responses of one session come in command order, responses of different
+// sessions interleave freely. The exception is a bare "stats": it is
+// answered at once from a snapshot at most a second old, so it can poll
+// a running genmove.
+class Server {
+public:
+  Server (Gtp::ReplWithGogui& gtp, const Gammas& gammas);
+
+  // Serves sessions multiplexed on in_fd until end of input.
+  // Sessions opened on the stream are closed when it ends.
+  void Serve (PlayoutPool& pool, int in_fd, int out_fd);
+
+  // Accepts connections on a Unix socket forever, each connection is
+  // served as by Serve. Returns false if the socket can't be set up.
+  bool Listen (PlayoutPool& pool, const std::string& socket_path);
+
+private:
+  class Session;
+  class Output;
+
+  // A client's thread, joined by Listen once done is set.
+  struct Connection {
+    std::thread thread;
+    std::atomic <bool> done;
+  };
+
+  void ServeConnection (PlayoutPool* pool, int fd, Connection* connection);
+  void CServer (Gtp::Io& io);
+
+  const Gammas& gammas;
+};
+
+#endif
@@ -0,0 +1,184 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+#include "tactics.hpp"
+
+Tactics::Tactics (Gtp::ReplWithGogui& gtp, const Gammas& gammas, Engine& engine)
+  : gammas (gammas), engine (engine)
+{
+  gtp.Register ("tactics", this, &Tactics::CTactics);
+}
+
+
+bool Tactics::ReadProblems (istream& in, vector <Problem>* problems, string* error) {
+  problems->clear ();
+  string text;
+  uint line_no = 0;
+  while (getline (in, text)) {
+    line_no += 1;
+    istringstream line (text);
+    Problem problem;
+    if (!(line >> problem.id) || problem.id [0] == '#') continue;
+
+    string answers;
+    line >> answers;
+    istringstream answer_list (answers);
+    string answer;
+    while (getline (answer_list, answer, ',')) {
+      Vertex v = Vertex::OfGtpString (answer);
+      if (v == Vertex::Invalid ()) {
+        *error = "line " + ::ToString (line_no) + ": bad answer: " + answer;
+        return false;
+      }
+      problem.answers.push_back (v);
+    }
+    if (problem.answers.empty ()) {
+      *error = "line " + ::ToString (line_no) + ": no answers";
+      return false;
+    }
+
+    while (true) {
+      Move m = Move::OfGtpStream (line);
+      if (!line) break;
+      problem.moves.push_back (m);
+    }
+    problems->push_back (problem);
+  }
+  return true;
+}
+
+
+vector <Tactics::Result> Tactics::Run (const vector <Problem>& problems,
+                                       uint min_playouts, uint max_playouts,
+                                       uint thread_count)
+{
+  vector <Result> results (problems.size ());
+  atomic <uint> next (0);
+  vector <thread> threads;
+  rep (ii, thread_count) {
+    threads.push_back (thread (&Tactics::Worker, this, &problems,
+                               min_playouts, max_playouts, &next, &results));
+  }
+  rep (ii, threads.size ()) threads [ii].join ();
+  return results;
+}
+
+
+void Tactics::Worker (const vector <Problem>* problems,
+                      uint min_playouts, uint max_playouts,
+                      atomic <uint>* next, vector <Result>* results)
+{
+  Engine* worker = new Engine (gammas);
+  worker->GetParam () = engine.GetParam ();
+  worker->SetQuiet (true);
+
+  while (true) {
+    uint index = next->fetch_add (1);
+    if (index >= problems->size ()) break;
+    (*results) [index] = Solve (*worker, (*problems) [index], min_playouts, max_playouts);
+  }
+
+  delete worker;
+}
+
+
+Tactics::Result Tactics::Solve (Engine& worker, const Problem& problem,
+                                uint min_playouts, uint max_playouts)
+{
+  Result result;
+  result.id = problem.id;
+  result.final_move = Vertex::Invalid ();
+  result.solved_playouts = 0;
+  result.solved_seconds = 0.0;
+
+  CHECK (worker.Reset (board_size));
+  result.legal = worker.SetPosition (problem.moves) == problem.moves.size ();
+  if (!result.legal) return result;
+
+  chrono::steady_clock::time_point begin = chrono::steady_clock::now ();
+  uint done = 0;
+  for (uint budget = max (min_playouts, 1u); budget <= max_playouts; budget *= 2) {
+    worker.DoNPlayouts (budget - done);
+    done = budget;
+    double mean;
+    result.final_move = worker.MostExploredMove (&mean).GetVertex ();
+    bool correct =
+      find (problem.answers.begin (), problem.answers.end (), result.final_move) !=
+      problem.answers.end ();
+    if (!correct) {
+      result.solved_playouts = 0;
+    } else if (result.solved_playouts == 0) {
+      result.solved_playouts = budget;
+      result.solved_seconds =
+        chrono::duration <double> (chrono::steady_clock::now () - begin).count ();
+    }
+  }
+  return result;
+}
+
+
+string Tactics::ToString (const vector <Result>& results) {
+  ostringstream out;
+  out << endl << "problem                        playouts   seconds  move" << endl;
+  uint solved = 0;
+  uint64 playouts = 0;
+  double seconds = 0.0;
+  rep (ii, results.size ()) {
+    const Result& r = results [ii];
+    out << setw (30) << left << r.id << right;
+    if (!r.legal) {
+      out << "  illegal position" << endl;
+      continue;
+    }
+    if (r.solved_playouts > 0) {
+      out << setw (10) << r.solved_playouts
+          << fixed << setprecision (3) << setw (10) << r.solved_seconds;
+      solved += 1;
+      playouts += r.solved_playouts;
+      seconds += r.solved_seconds;
+    } else {
+      out << setw (10) << "-" << setw (10) << "-";
+    }
+    out << "  " << r.final_move.ToGtpString () << endl;
+  }
+  out << solved << "/" << results.size () << " solved";
+  if (solved > 0) {
+    out << ", mean " << playouts / solved << " playouts, "
+        << fixed << setprecision (3) << seconds / solved << " s to solution";
+  }
+  return out.str ();
+}
+
+
+// Usage: tactics file [max_playouts] [min_playouts] [threads]
+// 0 threads means one per core.
+void Tactics::CTactics (Gtp::Io& io) {
+  string file_name = io.Read <string> ();
+  uint max_playouts = io.Read <uint> (20480);
+  uint min_playouts = io.Read <uint> (10);
+  uint thread_count = io.Read <uint> (0);
+  io.CheckEmpty ();
+
+  if (thread_count == 0) thread_count = max (thread::hardware_concurrency (), 1u);
+
+  ifstream in (file_name.c_str ());
+  if (!in) {
+    io.SetError ("can't open: " + file_name);
+    return;
+  }
+  vector <Problem> problems;
+  string error;
+  if (!ReadProblems (in, &problems, &error)) {
+    io.SetError (error);
+    return;
+  }
+  io.out << ToString (Run (problems, min_playouts, max_playouts, thread_count));
+}
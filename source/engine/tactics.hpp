@@ -0,0 +1,69 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#ifndef TACTICS_H_
+#define TACTICS_H_
+
+#include <atomic>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "gtp_gogui.hpp"
+#include "engine.hpp"
+
+// Tactical test suite: positions with known correct moves, searched with
+// doubling playout budgets to see how soon the search finds the answer.
+//
+// Every input line is "<id> <answers> [color vertex]*" where answers is
+// a comma separated list of correct vertices for the player to move.
+// Empty lines and lines starting with '#' are skipped.
+//
+// A position is solved at the smallest budget from which MostExploredMove
+// stays correct up to the largest budget. The tree is kept between
+// budgets, so a budget counts all playouts done so far.
+class Tactics {
+public:
+  // New engines copy their settings from the given one.
+  Tactics (Gtp::ReplWithGogui& gtp, const Gammas& gammas, Engine& engine);
+
+  struct Problem {
+    std::string id;
+    std::vector <Vertex> answers;
+    std::vector <Move> moves;
+  };
+
+  struct Result {
+    std::string id;
+    bool legal;
+    Vertex final_move;      // most explored at the largest budget
+    uint solved_playouts;   // 0 if not solved
+    double solved_seconds;
+  };
+
+  // Returns false on a bad line, sets error.
+  static bool ReadProblems (std::istream& in, std::vector <Problem>* problems,
+                            std::string* error);
+
+  // Searches every problem on thread_count threads, one engine each.
+  std::vector <Result> Run (const std::vector <Problem>& problems,
+                            uint min_playouts, uint max_playouts,
+                            uint thread_count);
+
+  // One line per problem and a summary.
+  static std::string ToString (const std::vector <Result>& results);
+
+private:
+  void Worker (const std::vector <Problem>* problems,
+               uint min_playouts, uint max_playouts,
+               std::atomic <uint>* next, std::vector <Result>* results);
+  Result Solve (Engine& worker, const Problem& problem,
+                uint min_playouts, uint max_playouts);
+  void CTactics (Gtp::Io& io);
+
+  const Gammas& gammas;
+  Engine& engine;
+};
+
+#endif
@@ -6,19 +6,17 @@
 #include "param.hpp"
 #include "gtp_gogui.hpp"
 
-extern Gtp::ReplWithGogui gtp;
 
-
-TimeControl::TimeControl () :
+TimeControl::TimeControl (const Param& param) :
     time_left (0.0),
     time_stones (-1),
-    playouts_per_second (10000)
+    playouts_per_second (10000),
+    param (param)
   {
-    gtp.Register ("time_left", this, &TimeControl::GtpTimeLeft);
   }
 
   uint TimeControl::PlayoutCount (Player player) {
-    int playouts = Param::genmove_playouts;
+    int playouts = param.genmove_playouts;
     if (time_stones [player] == 0 && time_left [player] < 60.0) {
       playouts = min (playouts,
                       int (time_left [player] / 30.0 * playouts_per_second));
@@ -7,17 +7,21 @@
 
 #include "utils.hpp"
 #include "player.hpp"
+#include "param.hpp"
 #include "gtp_gogui.hpp"
 
 class TimeControl {
 public:
-  TimeControl ();
+  explicit TimeControl (const Param& param);
   uint PlayoutCount (Player player);
   void GtpTimeLeft (Gtp::Io& io);
 
   NatMap <Player, float> time_left;
   NatMap <Player, int>   time_stones;
   float playouts_per_second;
+
+private:
+  const Param& param;
 };
 
 #endif /* TIME_CONTROL_H */
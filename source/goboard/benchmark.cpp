@@ -2,56 +2,86 @@
 // Copyright 2006 and onwards, Lukasz Lew
 //
 
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
 #include "benchmark.hpp"
 
 #include "fast_timer.hpp"
+#include "to_string.hpp"
 #include "utils.hpp"
 
 namespace Benchmark {
 
-  uint move_count = 0;
-  Board empty_board;
-  Board board;
-  FastRandom random (123);
   Gammas gammas;
-  Sampler sampler (board, gammas);
 
-  void DoPlayouts (uint playout_cnt, NatMap<Player, uint>* win_cnt) {
-    rep (ii, playout_cnt) {
+  // State of one playout loop, so loops can run concurrently.
+  class PlayoutLoop {
+  public:
+    explicit PlayoutLoop (uint seed) :
+      win_cnt (0), move_count (0), random (seed), sampler (board, gammas)
+    {
+    }
 
-      board.Load (empty_board);
-      sampler.NewPlayout ();
+    void DoPlayouts (uint playout_cnt) {
+      rep (ii, playout_cnt) {
 
-      while (!board.BothPlayerPass ()) {
-        Player pl = board.ActPlayer ();
-        Vertex v = sampler.SampleMove (random);
-        //Vertex v = board.RandomLightMove (pl, random);
-        board.PlayLegal (pl, v);
-        sampler.MovePlayed ();
-      }
+        board.Load (empty_board);
+        sampler.NewPlayout ();
+
+        while (!board.BothPlayerPass ()) {
+          Player pl = board.ActPlayer ();
+          Vertex v = sampler.SampleMove (random);
+          //Vertex v = board.RandomLightMove (pl, random);
+          board.PlayLegal (pl, v);
+          sampler.MovePlayed ();
+        }
 
-      (*win_cnt) [board.PlayoutWinner ()] ++;
-      move_count += board.MoveCount();
+        win_cnt [board.PlayoutWinner ()] ++;
+        move_count += board.MoveCount();
+      }
     }
-  }
+
+    NatMap <Player, uint> win_cnt;
+    uint64 move_count;
+
+  private:
+    Board empty_board;
+    Board board;
+    FastRandom random;
+    Sampler sampler;
+  };
 
   string Run (uint playout_cnt) {
-    NatMap <Player, uint> win_cnt (0);
+    PlayoutLoop loop (123);
     FastTimer fast_timer;
+    PerfCounters counters;
 
     fast_timer.Reset ();
     fast_timer.Start ();
+    counters.Start ();
     float seconds_begin = ProcessUserTime ();
     
-    DoPlayouts (playout_cnt, &win_cnt);
+    loop.DoPlayouts (playout_cnt);
 
     float seconds_end = ProcessUserTime ();
+    counters.Stop ();
     fast_timer.Stop ();
 
 
     float seconds_total = seconds_end - seconds_begin;
     float cc_per_playout = fast_timer.Ticks () / double (playout_cnt);
-    float cc_per_move    = fast_timer.Ticks () / double (move_count);
+    float cc_per_move    = fast_timer.Ticks () / double (loop.move_count);
+    NatMap <Player, uint>& win_cnt = loop.win_cnt;
     float playouts_finished = win_cnt [Player::Black ()] + win_cnt [Player::White ()];
 
     ostringstream ret;
@@ -62,8 +92,435 @@ namespace Benchmark {
         << cc_per_move  << " CC/move (clock independent)" << endl
         << win_cnt [Player::Black ()] << "/" << win_cnt [Player::White ()]
         << " (black wins / white wins)" << endl
-        << "AVG moves/playout = " << move_count / playouts_finished << endl;
+        << "AVG moves/playout = " << loop.move_count / playouts_finished << endl;
+
+    if (counters.IsAvailable ()) {
+      ret << "hardware counters:" << endl
+          << counters.ToString (loop.move_count, "move")
+          << counters.ToString (playout_cnt, "playout");
+    } else {
+      ret << "hardware counters unavailable" << endl;
+    }
 
     return ret.str();
   }
+
+  // ---------------------------------------------------------------------------
+  // Scaling over threads.
+
+  namespace {
+    void PinToCpu (uint cpu) {
+#ifdef __linux__
+      cpu_set_t set;
+      CPU_ZERO (&set);
+      CPU_SET (cpu, &set);
+      pthread_setaffinity_np (pthread_self (), sizeof (set), &set);
+#else
+      unused (cpu);
+#endif
+    }
+
+    // (package, core) of every logical cpu from sysfs. False if unknown.
+    bool ReadTopology (vector <pair <int, int> >* cores) {
+      cores->clear ();
+#ifdef __linux__
+      rep (cpu, thread::hardware_concurrency ()) {
+        string dir = "/sys/devices/system/cpu/cpu" + ::ToString (cpu) + "/topology/";
+        ifstream core_in ((dir + "core_id").c_str ());
+        ifstream package_in ((dir + "physical_package_id").c_str ());
+        int core, package;
+        if (!(core_in >> core) || !(package_in >> package)) return false;
+        cores->push_back (make_pair (package, core));
+      }
+      return true;
+#else
+      return false;
+#endif
+    }
+
+    // Distinct (package, core) pairs in sysfs, 0 if unknown.
+    uint PhysicalCoreCount () {
+      vector <pair <int, int> > cores;
+      if (!ReadTopology (&cores)) return 0;
+      return set <pair <int, int> > (cores.begin (), cores.end ()).size ();
+    }
+
+    // Logical cpus in the order threads get them: one per physical core
+    // first, then their SMT siblings. Cpu numbers when the topology is
+    // unknown.
+    vector <uint> CpuOrder () {
+      uint cpu_cnt = max (thread::hardware_concurrency (), 1u);
+      vector <pair <int, int> > cores;
+      vector <uint> first;
+      vector <uint> siblings;
+      if (!ReadTopology (&cores)) {
+        rep (cpu, cpu_cnt) first.push_back (cpu);
+        return first;
+      }
+      set <pair <int, int> > seen;
+      rep (cpu, cpu_cnt) {
+        if (seen.insert (cores [cpu]).second) {
+          first.push_back (cpu);
+        } else {
+          siblings.push_back (cpu);
+        }
+      }
+      first.insert (first.end (), siblings.begin (), siblings.end ());
+      return first;
+    }
+
+    void ThreadLoop (uint thread_no, uint cpu, uint playout_cnt,
+                     atomic <uint>* ready, const atomic <bool>* go)
+    {
+      PinToCpu (cpu);
+      PlayoutLoop loop (123 + thread_no);
+      ready->fetch_add (1);
+      while (!go->load ()) this_thread::yield ();
+      loop.DoPlayouts (playout_cnt);
+    }
+
+    // Aggregate kpps of thread_cnt threads, each doing playout_cnt playouts:
+    // all playouts over the wall time from the start to the last thread done.
+    double ThreadsKpps (uint thread_cnt, uint playout_cnt) {
+      vector <uint> cpus = CpuOrder ();
+      atomic <uint> ready (0);
+      atomic <bool> go (false);
+      vector <thread> threads;
+      rep (ii, thread_cnt) {
+        threads.push_back (thread (ThreadLoop, ii, cpus [ii % cpus.size ()],
+                                   playout_cnt, &ready, &go));
+      }
+      while (ready.load () < thread_cnt) this_thread::yield ();
+      chrono::steady_clock::time_point begin = chrono::steady_clock::now ();
+      go.store (true);
+      rep (ii, thread_cnt) threads [ii].join ();
+      double seconds =
+        chrono::duration <double> (chrono::steady_clock::now () - begin).count ();
+
+      return double (thread_cnt) * playout_cnt / max (seconds, 1e-9) / 1000.0;
+    }
+  }
+
+  string RunThreads (uint max_thread_cnt, uint playout_cnt) {
+    uint cpu_cnt = max (thread::hardware_concurrency (), 1u);
+    uint core_cnt = PhysicalCoreCount ();
+    if (max_thread_cnt == 0) max_thread_cnt = cpu_cnt;
+
+    ostringstream ret;
+    ret << endl << cpu_cnt << " logical cpus, ";
+    if (core_cnt > 0) {
+      ret << core_cnt << " physical cores";
+    } else {
+      ret << "physical cores unknown";
+    }
+    ret << ", " << playout_cnt << " playouts per thread" << endl
+        << "threads      kpps   speedup  efficiency  marginal" << endl;
+
+    vector <double> kpps (1, 0.0);
+    string knees;
+    reps (thread_cnt, 1, max_thread_cnt + 1) {
+      kpps.push_back (ThreadsKpps (thread_cnt, playout_cnt));
+      double speedup = kpps [thread_cnt] / kpps [1];
+      double efficiency = speedup / thread_cnt;
+      // Gain of the last thread relative to a lone thread.
+      double marginal = (kpps [thread_cnt] - kpps [thread_cnt - 1]) / kpps [1];
+
+      ret << setw (7) << thread_cnt << fixed << setprecision (1)
+          << setw (10) << kpps [thread_cnt]
+          << setw (10) << setprecision (2) << speedup
+          << setw (11) << setprecision (0) << 100.0 * efficiency << "%"
+          << setw (9) << 100.0 * marginal << "%" << endl;
+
+      if (thread_cnt > 1 && marginal < 0.5) {
+        knees += "saturation at " + ::ToString (thread_cnt) + " threads: ";
+        if (uint (thread_cnt) > cpu_cnt) {
+          knees += "more threads than logical cpus\n";
+        } else if (core_cnt > 0 && uint (thread_cnt) > core_cnt) {
+          knees += "more threads than physical cores (SMT)\n";
+        } else {
+          knees += "threads on separate cores, likely memory bandwidth or cache\n";
+        }
+      }
+    }
+    ret << (knees == "" ? "no saturation (every thread added at least 50%)\n" : knees);
+    return ret.str ();
+  }
+
+  // ---------------------------------------------------------------------------
+  // Suite workloads. Each has its own boards and random generator with
+  // a fixed seed, so repeats do the same work.
+
+  // Playouts with RandomLightMove (no patterns) from the empty board.
+  uint64 LightPlayouts (uint n) {
+    Board start;
+    Board board;
+    FastRandom random (123);
+    uint64 moves = 0;
+    rep (ii, n) {
+      board.Load (start);
+      while (!board.BothPlayerPass ()) {
+        if (board.MoveCount () >= 3 * Board::kArea) break;
+        Player pl = board.ActPlayer ();
+        board.PlayLegal (pl, board.RandomLightMove (pl, random));
+      }
+      moves += board.MoveCount ();
+    }
+    return moves;
+  }
+
+  // Sampler playouts starting in turn from the given positions.
+  uint64 SamplerPlayouts (const vector <Board>& starts, uint n) {
+    Board board;
+    Sampler sampler (board, gammas);
+    FastRandom random (123);
+    uint64 moves = 0;
+    rep (ii, n) {
+      const Board& start = starts [ii % starts.size ()];
+      board.Load (start);
+      sampler.NewPlayout ();
+      while (!board.BothPlayerPass ()) {
+        Player pl = board.ActPlayer ();
+        board.PlayLegal (pl, sampler.SampleMove (random));
+        sampler.MovePlayed ();
+      }
+      moves += board.MoveCount () - start.MoveCount ();
+    }
+    return moves;
+  }
+
+  // Positions after 20 to 51 sampler moves of seeded games.
+  vector <Board> MidgamePositions () {
+    vector <Board> positions (32);
+    rep (ii, positions.size ()) {
+      Board& board = positions [ii];
+      Sampler sampler (board, gammas);
+      FastRandom random (1000 + ii);
+      sampler.NewPlayout ();
+      while (board.MoveCount () < 20 + ii && !board.BothPlayerPass ()) {
+        Player pl = board.ActPlayer ();
+        board.PlayLegal (pl, sampler.SampleMove (random));
+        sampler.MovePlayed ();
+      }
+    }
+    return positions;
+  }
+
+  Suite::Suite () {
+    vector <Board> empty (1);
+    Add ("light", "playouts", 20000, LightPlayouts);
+    Add ("sampler", "playouts", 20000,
+         bind (SamplerPlayouts, empty, placeholders::_1));
+    Add ("midgame", "playouts", 20000,
+         bind (SamplerPlayouts, MidgamePositions (), placeholders::_1));
+  }
+
+  void Suite::Add (const string& name, const string& unit,
+                   uint n, Workload workload)
+  {
+    Entry entry;
+    entry.name = name;
+    entry.unit = unit;
+    entry.n = n;
+    entry.workload = workload;
+    entries.push_back (entry);
+  }
+
+  void Suite::SetAllocCounter (std::function <uint64 ()> new_alloc_count) {
+    alloc_count = new_alloc_count;
+  }
+
+  vector <Result> Suite::Run (uint repeats) const {
+    vector <Result> results;
+    rep (ii, entries.size ()) {
+      const Entry& entry = entries [ii];
+      vector <double> rates;
+      double ticks = 0.0;
+      uint64 moves = 0;
+      uint64 allocs = 0;
+      PerfCounters counters;
+
+      rep (jj, repeats) {
+        FastTimer fast_timer;
+        fast_timer.Reset ();
+        fast_timer.Start ();
+        counters.Start ();
+        uint64 allocs_begin = alloc_count ? alloc_count () : 0;
+        float seconds_begin = ProcessUserTime ();
+        moves += entry.workload (entry.n);
+        float seconds = ProcessUserTime () - seconds_begin;
+        if (alloc_count) allocs += alloc_count () - allocs_begin;
+        counters.Stop ();
+        fast_timer.Stop ();
+        ticks += fast_timer.Ticks ();
+        rates.push_back (entry.n / max (seconds, 1e-6f));
+      }
+
+      Result result;
+      result.name = entry.name;
+      result.unit = entry.unit;
+      result.n = entry.n;
+      result.repeats = repeats;
+      result.rate_mean = 0.0;
+      result.rate_min = rates [0];
+      result.rate_max = rates [0];
+      rep (jj, repeats) {
+        result.rate_mean += rates [jj] / repeats;
+        result.rate_min = min (result.rate_min, rates [jj]);
+        result.rate_max = max (result.rate_max, rates [jj]);
+      }
+      double var = 0.0;
+      rep (jj, repeats) {
+        var += (rates [jj] - result.rate_mean) * (rates [jj] - result.rate_mean);
+      }
+      result.rate_stddev = repeats > 1 ? sqrt (var / (repeats - 1)) : 0.0;
+      result.cc_per_move = moves > 0 ? ticks / moves : 0.0;
+      if (alloc_count) {
+        result.counters ["allocs_per_unit"] = allocs / (double (entry.n) * repeats);
+      }
+      rep (kk, PerfCounters::kCount) {
+        PerfCounters::Counter c = PerfCounters::Counter (kk);
+        if (!counters.Has (c)) continue;
+        string key = PerfCounters::Key (c);
+        double total = counters.Get (c);
+        result.counters [key + "_per_unit"] = total / (double (entry.n) * repeats);
+        if (moves > 0) result.counters [key + "_per_move"] = total / moves;
+      }
+      results.push_back (result);
+    }
+    return results;
+  }
+
+  // ---------------------------------------------------------------------------
+
+  string Result::ToJson () const {
+    ostringstream out;
+    out << fixed << setprecision (2)
+        << "{\"name\": \"" << name << "\", \"unit\": \"" << unit << "\""
+        << ", \"n\": " << n << ", \"repeats\": " << repeats
+        << ", \"rate_mean\": " << rate_mean
+        << ", \"rate_stddev\": " << rate_stddev
+        << ", \"rate_min\": " << rate_min
+        << ", \"rate_max\": " << rate_max
+        << ", \"cc_per_move\": " << cc_per_move;
+    for (map <string, double>::const_iterator it = counters.begin ();
+         it != counters.end ();
+         ++it)
+    {
+      out << ", \"" << it->first << "\": " << it->second;
+    }
+    out << "}";
+    return out.str ();
+  }
+
+  string Result::ToString () const {
+    ostringstream out;
+    out << setw (14) << left << name << right << fixed << setprecision (1)
+        << setw (12) << rate_mean << " " << unit << "/s"
+        << "  +- " << setprecision (1) << 100.0 * rate_stddev / rate_mean << "%"
+        << "  [" << rate_min << " .. " << rate_max << "]";
+    if (cc_per_move > 0.0) out << "  " << setprecision (0) << cc_per_move << " CC/move";
+    map <string, double>::const_iterator instructions = counters.find ("instructions_per_unit");
+    map <string, double>::const_iterator cycles = counters.find ("cycles_per_unit");
+    if (instructions != counters.end () && cycles != counters.end ()) {
+      out << "  IPC " << setprecision (2) << instructions->second / cycles->second;
+    }
+    map <string, double>::const_iterator misses = counters.find ("llc_misses_per_move");
+    if (misses != counters.end ()) {
+      out << "  " << setprecision (2) << misses->second << " LLC misses/move";
+    }
+    map <string, double>::const_iterator allocs = counters.find ("allocs_per_unit");
+    if (allocs != counters.end ()) {
+      out << "  " << setprecision (2) << allocs->second << " allocs/unit";
+    }
+    return out.str ();
+  }
+
+  string ToJson (const vector <Result>& results) {
+    ostringstream out;
+    out << "[" << endl;
+    rep (ii, results.size ()) {
+      out << "  " << results [ii].ToJson ()
+          << (ii + 1 < results.size () ? "," : "") << endl;
+    }
+    out << "]" << endl;
+    return out.str ();
+  }
+
+  namespace {
+    // Finds "key": in the line and reads the value after it.
+    template <typename T>
+    bool ReadField (const string& line, const string& key, T* value) {
+      size_t pos = line.find ("\"" + key + "\":");
+      if (pos == string::npos) return false;
+      istringstream in (line.substr (pos + key.size () + 3));
+      if (in >> ws && in.peek () == '"') {
+        in.get ();
+        string s;
+        getline (in, s, '"');
+        istringstream (s) >> *value;
+        return true;
+      }
+      return bool (in >> *value);
+    }
+  }
+
+  bool ReadJson (istream& in, vector <Result>* results) {
+    results->clear ();
+    string line;
+    while (getline (in, line)) {
+      if (line.find ('{') == string::npos) continue;
+      Result r;
+      if (!ReadField (line, "name",        &r.name) ||
+          !ReadField (line, "unit",        &r.unit) ||
+          !ReadField (line, "n",           &r.n) ||
+          !ReadField (line, "repeats",     &r.repeats) ||
+          !ReadField (line, "rate_mean",   &r.rate_mean) ||
+          !ReadField (line, "rate_stddev", &r.rate_stddev) ||
+          !ReadField (line, "rate_min",    &r.rate_min) ||
+          !ReadField (line, "rate_max",    &r.rate_max) ||
+          !ReadField (line, "cc_per_move", &r.cc_per_move)) {
+        return false;
+      }
+      results->push_back (r);
+    }
+    return true;
+  }
+
+  string Compare (const vector <Result>& baseline,
+                  const vector <Result>& current,
+                  double tolerance,
+                  uint* regression_count)
+  {
+    ostringstream out;
+    *regression_count = 0;
+    rep (ii, current.size ()) {
+      const Result& cur = current [ii];
+      const Result* base = NULL;
+      rep (jj, baseline.size ()) {
+        if (baseline [jj].name == cur.name) base = &baseline [jj];
+      }
+      out << cur.ToString () << endl;
+      if (base == NULL) {
+        out << "  no baseline" << endl;
+        continue;
+      }
+      double change = cur.rate_mean / base->rate_mean - 1.0;
+      double noise = 2.0 * (cur.rate_stddev + base->rate_stddev) / base->rate_mean;
+      // Beyond both the tolerance and the noise.
+      bool regression = change < -max (tolerance, noise);
+      out << "  baseline " << fixed << setprecision (1) << base->rate_mean
+          << " " << base->unit << "/s, change " << showpos << 100.0 * change
+          << noshowpos << "%" << (regression ? "  REGRESSION" : "") << endl;
+      if (regression) *regression_count += 1;
+    }
+
+    rep (jj, baseline.size ()) {
+      bool found = false;
+      rep (ii, current.size ()) found |= current [ii].name == baseline [jj].name;
+      if (found) continue;
+      out << baseline [jj].name << "  missing from this run  REGRESSION" << endl;
+      *regression_count += 1;
+    }
+    return out.str ();
+  }
 }
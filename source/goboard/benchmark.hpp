@@ -5,12 +5,91 @@
 #ifndef BENCHMARK_H_
 #define BENCHMARK_H_
 
+#include <functional>
+#include <map>
 #include <string>
+#include <vector>
 
 #include "board.hpp"
+#include "perf_counters.hpp"
 
 namespace Benchmark {
   string Run (uint playout_cnt);
+
+  // Independent playout loops on 1 .. max_thread_cnt threads pinned to
+  // cpus (0 means all cpus), one per physical core before SMT siblings.
+  // Reports aggregate kpps (all playouts over the wall time), efficiency
+  // and the thread counts where adding a thread gains less than half of a
+  // lone one.
+  string RunThreads (uint max_thread_cnt, uint playout_cnt);
+
+  // Does n units of work (playouts, genmoves, ...).
+  // Returns the number of board moves played, 0 if unknown.
+  typedef std::function <uint64 (uint n)> Workload;
+
+  struct Result {
+    string name;
+    string unit;
+    uint n;                     // units per repeat
+    uint repeats;
+    double rate_mean;           // units per second
+    double rate_stddev;
+    double rate_min;
+    double rate_max;
+    double cc_per_move;         // 0 if moves are unknown
+
+    // Hardware counters per unit and per move, e.g. "cycles_per_unit".
+    // Only available counters are present. Also heap allocations per
+    // unit ("allocs_per_unit") when the suite has an allocation counter.
+    map <string, double> counters;
+
+    string ToJson () const;
+    string ToString () const;
+  };
+
+  // Set of workloads run and reported together.
+  // Initially contains board workloads: light and sampler playouts from
+  // the empty board and sampler playouts from mid-game positions.
+  class Suite {
+  public:
+    Suite ();
+
+    void Add (const string& name, const string& unit, uint n, Workload workload);
+
+    // Returns the number of heap allocations so far. The engine does not
+    // count them; alloc_test links a counting operator new and sets this.
+    void SetAllocCounter (std::function <uint64 ()> alloc_count);
+
+    // Runs every workload repeats times.
+    vector <Result> Run (uint repeats) const;
+
+  private:
+    struct Entry {
+      string name;
+      string unit;
+      uint n;
+      Workload workload;
+    };
+    vector <Entry> entries;
+    std::function <uint64 ()> alloc_count;
+  };
+
+  // One result per line, as a JSON array.
+  string ToJson (const vector <Result>& results);
+
+  // Reads what ToJson wrote. Returns false on bad format.
+  bool ReadJson (istream& in, vector <Result>* results);
+
+  // Compares rates of workloads present in both sets. A workload is a
+  // regression when its rate dropped by more than tolerance (a fraction)
+  // and by more than two standard deviations of the two runs, so noisy
+  // results need a bigger drop. A baseline workload missing from current
+  // counts as a regression too.
+  // Returns a report, sets regression_count.
+  string Compare (const vector <Result>& baseline,
+                  const vector <Result>& current,
+                  double tolerance,
+                  uint* regression_count);
 }
 
 #endif
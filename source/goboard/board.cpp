@@ -5,6 +5,7 @@
 #include <cmath>
 #include <cstring>
 #include <iostream>
+#include <unordered_set>
 
 #include "board.hpp"
 #include "fast_stack.hpp"
@@ -981,6 +982,26 @@ bool Board::Undo () {
 }
 
 
+uint Board::Replay (const vector<Move>& replay) {
+  Clear ();
+  // Positions after each move, as in IsHashRepeated.
+  unordered_set <uint64> history;
+  rep (ii, replay.size()) {
+    Move m = replay [ii];
+    if (!m.IsValid () || !IsLegal (m)) return ii;
+    PlayLegal (m);
+    Hash hash = PositionalHash ();
+    uint64 key = (uint64 (hash.Lock ()) << 32) | hash.Index ();
+    if (m.GetVertex () != Vertex::Pass () && history.count (key) > 0) {
+      Undo ();
+      return ii;
+    }
+    history.insert (key);
+  }
+  return replay.size();
+}
+
+
 bool Board::IsReallyLegal (Move move) const {
   if (IsLegal (move) == false) return false;
 
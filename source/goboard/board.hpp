@@ -281,6 +281,11 @@ public:
   // Loads position (and history) from other board.
   void Load (const Board& save_board);
 
+  // Clears the board and plays the moves checking them like IsReallyLegal.
+  // Superko history is built once for the whole list.
+  // Stops before the first illegal move and returns the number of moves played.
+  uint Replay (const vector<Move>& replay);
+
   // Returns list of played moves.
   const vector<Move>& Moves () const;
 
@@ -0,0 +1,206 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#include <set>
+
+#include "board_fuzz.hpp"
+#include "reference_board.hpp"
+#include "to_string.hpp"
+
+namespace BoardFuzz {
+
+  namespace {
+    template <typename T>
+    bool Differs (const string& what, const T& raw, const T& reference,
+                  string* report)
+    {
+      if (raw == reference) return false;
+      ostringstream out;
+      out << what << ": board " << raw << ", reference " << reference;
+      *report = out.str ();
+      return true;
+    }
+
+    uint StoneCount (const RawBoard& board, Player pl) {
+      uint count = 0;
+      ForEachNat (Vertex, v) {
+        if (v.IsOnBoard () && board.ColorAt (v) == Color::OfPlayer (pl)) count += 1;
+      }
+      return count;
+    }
+
+    bool Compare (const RawBoard& board, const ReferenceBoard& ref,
+                  string* report)
+    {
+      uint empty_count = 0;
+      ForEachNat (Vertex, v) {
+        if (!v.IsOnBoard ()) continue;
+        string at = " at " + v.ToGtpString ();
+        if (Differs ("color" + at,
+                     board.ColorAt (v).ToShowboardChar (),
+                     ref.ColorAt (v).ToShowboardChar (), report)) {
+          return true;
+        }
+        if (ref.ColorAt (v) != Color::Empty ()) continue;
+        empty_count += 1;
+        if (Differs ("Hash3x3" + at,
+                     board.Hash3x3At (v).ToString (),
+                     ref.Hash3x3At (v).ToString (), report)) {
+          return true;
+        }
+        ForEachNat (Player, pl) {
+          string of = " of " + pl.ToGtpString () + at;
+          if (Differs ("legality" + of, board.IsLegal (pl, v),
+                       ref.IsLegal (pl, v), report) ||
+              Differs ("eyelike" + of, board.IsEyelike (pl, v),
+                       ref.IsEyelike (pl, v), report)) {
+            return true;
+          }
+        }
+      }
+
+      set <uint> empty_listed;
+      rep (ii, board.EmptyVertexCount ()) {
+        Vertex v = board.EmptyVertex (ii);
+        if (ref.ColorAt (v) != Color::Empty ()) {
+          *report = "empty vertex list contains " + v.ToGtpString ();
+          return true;
+        }
+        empty_listed.insert (v.GetRaw ());
+      }
+
+      return
+        Differs ("empty vertex count", board.EmptyVertexCount (), empty_count, report) ||
+        Differs ("distinct empty vertices", uint (empty_listed.size ()), empty_count, report) ||
+        Differs ("player to move", board.ActPlayer ().ToGtpString (),
+                 ref.ActPlayer ().ToGtpString (), report) ||
+        Differs ("move count", board.MoveCount (), ref.MoveCount (), report) ||
+        Differs ("both pass", board.BothPlayerPass (), ref.BothPlayerPass (), report) ||
+        Differs ("ko vertex", board.KoVertex ().ToGtpString (),
+                 ref.KoVertex ().ToGtpString (), report) ||
+        Differs ("positional hash", uint64 (board.PositionalHash ().Lock ()) << 32 |
+                 board.PositionalHash ().Index (),
+                 uint64 (ref.PositionalHash ().Lock ()) << 32 |
+                 ref.PositionalHash ().Index (), report) ||
+        Differs ("stone score", board.StoneScore (), ref.StoneScore (), report) ||
+        Differs ("playout score", board.PlayoutScore (), ref.PlayoutScore (), report) ||
+        Differs ("Tromp-Taylor score", board.TrompTaylorScore (),
+                 ref.TrompTaylorScore (), report);
+    }
+
+    string MovesToString (const vector <Move>& moves) {
+      ostringstream out;
+      rep (ii, moves.size ()) out << (ii > 0 ? " " : "") << moves [ii].ToGtpString ();
+      return out.str ();
+    }
+
+    // Random legal moves of the reference board, mostly avoiding own eyes.
+    void RandomGame (FastRandom& random, vector <Move>* moves) {
+      ReferenceBoard ref;
+      moves->clear ();
+      while (!ref.BothPlayerPass () && ref.MoveCount () < 3 * RawBoard::kArea) {
+        Player pl = ref.ActPlayer ();
+        bool fill_eyes = random.GetNextUint (20) == 0;
+        vector <Vertex> candidates;
+        ForEachNat (Vertex, v) {
+          if (!v.IsOnBoard () || !ref.IsLegal (pl, v)) continue;
+          if (!fill_eyes && ref.IsEyelike (pl, v)) continue;
+          candidates.push_back (v);
+        }
+        Vertex v = Vertex::Pass ();
+        if (!candidates.empty () && random.GetNextUint (100) != 0) {
+          v = candidates [random.GetNextUint (candidates.size ())];
+        }
+        ref.PlayLegal (pl, v);
+        moves->push_back (Move (pl, v));
+      }
+    }
+  }
+
+  bool FindDivergence (const vector <Move>& moves, uint* played, string* report) {
+    RawBoard board;
+    ReferenceBoard ref;
+    *played = 0;
+    if (Compare (board, ref, report)) return true;
+
+    rep (ii, moves.size ()) {
+      Move m = moves [ii];
+      Player pl = m.GetPlayer ();
+      Vertex v = m.GetVertex ();
+      string what = "move " + ::ToString (ii + 1) + " " + m.ToGtpString ();
+      bool legal = ref.IsLegal (pl, v);
+      if (Differs (what + " legality", board.IsLegal (m), legal, report)) return true;
+      if (!legal) return false;
+
+      uint stones = StoneCount (board, pl.Other ());
+      board.PlayLegal (m);
+      uint captured = ref.PlayLegal (pl, v);
+      *played = ii + 1;
+
+      if (Differs (what + " captures", stones - StoneCount (board, pl.Other ()),
+                   captured, report) ||
+          Compare (board, ref, report)) {
+        *report = what + ": " + *report + "\n" + board.ToAsciiArt (v);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  vector <Move> Shrink (const vector <Move>& moves) {
+    uint played;
+    string report;
+    CHECK (FindDivergence (moves, &played, &report));
+    vector <Move> best (moves.begin (), moves.begin () + played);
+
+    // Remove chunks of halving size while the game still diverges.
+    uint chunk = max (best.size () / 2, size_t (1));
+    while (true) {
+      bool removed = false;
+      uint ii = 0;
+      while (ii < best.size ()) {
+        vector <Move> candidate (best.begin (), best.begin () + ii);
+        candidate.insert (candidate.end (),
+                          best.begin () + min (ii + chunk, uint (best.size ())),
+                          best.end ());
+        if (FindDivergence (candidate, &played, &report)) {
+          best.assign (candidate.begin (), candidate.begin () + played);
+          removed = true;
+        } else {
+          ii += chunk;
+        }
+      }
+      if (chunk == 1 && !removed) break;
+      if (!removed) chunk = max (chunk / 2, 1u);
+    }
+    return best;
+  }
+
+  string Run (uint game_count, uint seed, bool* ok) {
+    FastRandom random (seed);
+    uint64 move_count = 0;
+    ostringstream out;
+    *ok = true;
+    // One buffer for all games.
+    vector <Move> moves;
+    rep (game, game_count) {
+      RandomGame (random, &moves);
+      move_count += moves.size ();
+      uint played;
+      string report;
+      if (!FindDivergence (moves, &played, &report)) continue;
+
+      vector <Move> shrunk = Shrink (moves);
+      FindDivergence (shrunk, &played, &report);
+      out << "divergence in game " << game << " (seed " << seed << ")" << endl
+          << "game:   " << MovesToString (moves) << endl
+          << "shrunk: " << MovesToString (shrunk) << endl
+          << report;
+      *ok = false;
+      return out.str ();
+    }
+    out << game_count << " games, " << move_count << " moves, no divergence";
+    return out.str ();
+  }
+}
@@ -0,0 +1,33 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#ifndef BOARD_FUZZ_H_
+#define BOARD_FUZZ_H_
+
+#include <string>
+#include <vector>
+
+#include "board.hpp"
+
+// Differential testing of RawBoard against ReferenceBoard.
+// Random games are played on both boards; after every move colors,
+// legality, eyes, ko, captures, hashes, Hash3x3 and scores are compared.
+namespace BoardFuzz {
+
+  // Replays moves on both boards, comparing them before the first move
+  // and after each one. Returns true on the first difference, describes
+  // it in report and sets played to the number of moves played on both
+  // boards. A move illegal on both boards ends the replay.
+  bool FindDivergence (const vector <Move>& moves, uint* played, string* report);
+
+  // Removes moves while the game still diverges and cuts it after the
+  // divergence. Assumes FindDivergence (moves) is true.
+  vector <Move> Shrink (const vector <Move>& moves);
+
+  // Plays game_count seeded games. Stops at the first divergence and
+  // reports it with the shrunk counterexample. Sets ok.
+  string Run (uint game_count, uint seed, bool* ok);
+}
+
+#endif
@@ -14,6 +14,14 @@
 
 #include "hash.cpp"
 #include "board.cpp"
+#include "reference_board.cpp"
+#include "board_fuzz.cpp"
+#include "perft.cpp"
+#include "game_corpus.cpp"
+#include "move_prediction.cpp"
+#include "sgf.cpp"
+#include "gammas.cpp"
 
 #include "benchmark.cpp"
+#include "microbenchmark.cpp"
 #include "playout_test.cpp"
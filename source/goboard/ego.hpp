@@ -20,11 +20,18 @@
 
 #include "hash.hpp"
 #include "board.hpp"
+#include "reference_board.hpp"
+#include "board_fuzz.hpp"
+#include "perft.hpp"
+#include "game_corpus.hpp"
+#include "sgf.hpp"
 
 #include "gammas.hpp"
 #include "sampler.hpp"
+#include "move_prediction.hpp"
 
 #include "benchmark.hpp"
+#include "microbenchmark.hpp"
 #include "playout_test.hpp"
 
 #endif
@@ -0,0 +1,541 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+
+#ifndef _MSC_VER
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "game_corpus.hpp"
+#include "board.hpp"
+#include "sgf.hpp"
+
+namespace GameCorpus {
+
+  namespace {
+    const char kMagic [8] = { 'E', 'G', 'O', 'G', 'A', 'M', 'E', 'S' };
+    const uint32_t kVersion = 1;
+    const uint16_t kPassIndex = 0x7fff;
+
+    struct Header {
+      char magic [8];
+      uint32_t version;
+      uint32_t board_size;
+      uint64 game_count;
+      uint64 move_count;
+      uint64 index_offset;
+    };
+
+    uint16_t Encode (Move m) {
+      Vertex v = m.GetVertex ();
+      uint16_t index = v == Vertex::Pass () ?
+        kPassIndex : v.GetRow () * board_size + v.GetColumn ();
+      return uint16_t (m.GetPlayer ().GetRaw () << 15) | index;
+    }
+
+    Move Decode (uint16_t code) {
+      uint index = code & kPassIndex;
+      Vertex v = index == kPassIndex ?
+        Vertex::Pass () :
+        Vertex::OfCoords (index / board_size, index % board_size);
+      return Move (Player::OfRaw (code >> 15), v);
+    }
+
+    uint64 MovesOffset () {
+      return sizeof (Header);
+    }
+  }
+
+  // Writer
+
+  Writer::Writer () : file (NULL), move_count (0), ok (false) {
+  }
+
+  Writer::~Writer () {
+    if (file != NULL) Close ();
+  }
+
+  bool Writer::Open (const string& file_name) {
+    CHECK (file == NULL);
+    file = fopen (file_name.c_str (), "wb");
+    if (file == NULL) return false;
+    offsets.assign (1, 0);
+    move_count = 0;
+    // Placeholder, the header is rewritten by Close.
+    Header header;
+    memset (&header, 0, sizeof (header));
+    ok = fwrite (&header, sizeof (header), 1, file) == 1;
+    return ok;
+  }
+
+  void Writer::Add (const vector <Move>& moves) {
+    CHECK (file != NULL);
+    vector <uint16_t> codes (moves.size ());
+    rep (ii, moves.size ()) codes [ii] = Encode (moves [ii]);
+    if (!codes.empty ()) {
+      ok &= fwrite (codes.data (), sizeof (uint16_t), codes.size (), file) == codes.size ();
+    }
+    move_count += moves.size ();
+    offsets.push_back (move_count);
+  }
+
+  bool Writer::Close () {
+    CHECK (file != NULL);
+    uint64 end = MovesOffset () + move_count * sizeof (uint16_t);
+    uint64 index_offset = (end + 7) / 8 * 8;
+    const char padding [8] = {};
+    ok &= fwrite (padding, 1, index_offset - end, file) == index_offset - end;
+    ok &= fwrite (offsets.data (), sizeof (uint64), offsets.size (), file) == offsets.size ();
+
+    Header header;
+    memcpy (header.magic, kMagic, sizeof (kMagic));
+    header.version = kVersion;
+    header.board_size = board_size;
+    header.game_count = offsets.size () - 1;
+    header.move_count = move_count;
+    header.index_offset = index_offset;
+    ok &= fseek (file, 0, SEEK_SET) == 0;
+    ok &= fwrite (&header, sizeof (header), 1, file) == 1;
+    ok &= fclose (file) == 0;
+    file = NULL;
+    return ok;
+  }
+
+  uint64 Writer::GameCount () const {
+    return offsets.empty () ? 0 : offsets.size () - 1;
+  }
+
+  // Reader
+
+  Reader::Reader () :
+    data (NULL), size (0), moves (NULL), index (NULL), game_count (0), move_count (0)
+  {
+  }
+
+  Reader::~Reader () {
+    Close ();
+  }
+
+  bool Reader::Open (const string& file_name, string* error) {
+    Close ();
+
+#ifdef _MSC_VER
+    // No mmap, the file is read into memory.
+    ifstream in (file_name.c_str (), ifstream::binary);
+    if (!in) {
+      *error = "can't open " + file_name;
+      return false;
+    }
+    in.seekg (0, ifstream::end);
+    size = size_t (in.tellg ());
+    in.seekg (0, ifstream::beg);
+    char* buffer = new char [size];
+    in.read (buffer, size);
+    data = buffer;
+    if (!in) {
+      Close ();
+      *error = "can't read " + file_name;
+      return false;
+    }
+#else
+    int fd = open (file_name.c_str (), O_RDONLY);
+    if (fd < 0) {
+      *error = "can't open " + file_name;
+      return false;
+    }
+    struct stat st;
+    if (fstat (fd, &st) != 0 || st.st_size < off_t (sizeof (Header))) {
+      close (fd);
+      *error = file_name + " is not a game corpus";
+      return false;
+    }
+    size = st.st_size;
+    void* map = mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (map == MAP_FAILED) {
+      size = 0;
+      *error = "can't map " + file_name;
+      return false;
+    }
+    data = static_cast <const char*> (map);
+#endif
+
+    Header header;
+    if (size < sizeof (header)) {
+      Close ();
+      *error = file_name + " is not a game corpus";
+      return false;
+    }
+    memcpy (&header, data, sizeof (header));
+    if (memcmp (header.magic, kMagic, sizeof (kMagic)) != 0) {
+      Close ();
+      *error = file_name + " is not a game corpus";
+      return false;
+    }
+    if (header.version != kVersion) {
+      Close ();
+      *error = file_name + ": unsupported version " + ToString (header.version);
+      return false;
+    }
+    if (header.board_size != board_size) {
+      Close ();
+      *error = file_name + ": board size " + ToString (header.board_size) +
+        ", expected " + ToString (board_size);
+      return false;
+    }
+    // Counts are bounded by the size first, so the products can't overflow.
+    if (header.move_count > (size - MovesOffset ()) / sizeof (uint16_t) ||
+        header.game_count >= size / sizeof (uint64) ||
+        header.index_offset % 8 != 0 ||
+        header.index_offset < MovesOffset () + header.move_count * sizeof (uint16_t) ||
+        header.index_offset > size ||
+        size - header.index_offset != (header.game_count + 1) * sizeof (uint64))
+    {
+      Close ();
+      *error = file_name + ": truncated or corrupted";
+      return false;
+    }
+
+    game_count = header.game_count;
+    move_count = header.move_count;
+    moves = reinterpret_cast <const uint16_t*> (data + MovesOffset ());
+    index = reinterpret_cast <const uint64*> (data + header.index_offset);
+
+    // Offsets must be nondecreasing and end at move_count.
+    bool index_ok = index [0] == 0 && index [game_count] == move_count;
+    for (uint64 game = 0; game < game_count; game++) {
+      index_ok &= index [game] <= index [game + 1];
+    }
+    if (!index_ok) {
+      Close ();
+      *error = file_name + ": bad game index";
+      return false;
+    }
+
+    // Decode would turn an index off the board into Vertex::Invalid.
+    uint64 bad_move = move_count;
+    for (uint64 ii = 0; ii < move_count && bad_move == move_count; ii++) {
+      uint vertex_index = moves [ii] & kPassIndex;
+      if (vertex_index != kPassIndex && vertex_index >= board_size * board_size) {
+        bad_move = ii;
+      }
+    }
+    if (bad_move != move_count) {
+      Close ();
+      *error = file_name + ": bad move code at move " + ToString (bad_move);
+      return false;
+    }
+    return true;
+  }
+
+  void Reader::Close () {
+    if (data != NULL) {
+#ifdef _MSC_VER
+      delete [] data;
+#else
+      munmap (const_cast <char*> (data), size);
+#endif
+    }
+    data = NULL;
+    size = 0;
+    moves = NULL;
+    index = NULL;
+    game_count = 0;
+    move_count = 0;
+  }
+
+  uint64 Reader::GameCount () const {
+    return game_count;
+  }
+
+  uint64 Reader::TotalMoveCount () const {
+    return move_count;
+  }
+
+  uint Reader::MoveCount (uint64 game) const {
+    ASSERT (game < game_count);
+    return index [game + 1] - index [game];
+  }
+
+  Move Reader::GetMove (uint64 game, uint ii) const {
+    ASSERT (ii < MoveCount (game));
+    return Decode (moves [index [game] + ii]);
+  }
+
+  vector <Move> Reader::GetGame (uint64 game) const {
+    vector <Move> game_moves (MoveCount (game));
+    rep (ii, game_moves.size ()) game_moves [ii] = GetMove (game, ii);
+    return game_moves;
+  }
+
+  // Converter
+
+  bool ConvertText (istream& in, const string& out_file_name,
+                    uint64* game_count, string* error)
+  {
+    Writer writer;
+    if (!writer.Open (out_file_name)) {
+      *error = "can't open " + out_file_name;
+      return false;
+    }
+
+    vector <Move> moves;
+    string s;
+    while (in >> s) {
+      string name;
+      uint bs;
+      uint move_count;
+      if (s != "file" || !getline (in, name) || !(in >> bs >> move_count)) {
+        *error = "bad game header after game " + ToString (writer.GameCount ());
+        writer.Close ();
+        return false;
+      }
+      moves.resize (move_count);
+      rep (ii, move_count) {
+        moves [ii] = Move::OfGtpStream (in);
+        if (!moves [ii].IsValid ()) {
+          *error = "bad move " + ToString (ii) + " in file" + name;
+          writer.Close ();
+          return false;
+        }
+      }
+      if (bs == board_size) writer.Add (moves);
+    }
+
+    *game_count = writer.GameCount ();
+    if (!writer.Close ()) {
+      *error = "can't write " + out_file_name;
+      return false;
+    }
+    return true;
+  }
+
+  // SGF converter
+
+  namespace {
+    enum SgfResult { kSgfOk, kSgfBad, kSgfSize, kSgfRank, kSgfSetup, kSgfIllegal };
+
+    // Workers read and check files at most kSgfWindow ahead of the writer,
+    // which writes them in order.
+    const uint kSgfWindow = 4096;
+
+    bool HasSgfExtension (const string& name) {
+      if (name.size () < 4) return false;
+      string ext = name.substr (name.size () - 4);
+      rep (ii, ext.size ()) ext [ii] = tolower (ext [ii]);
+      return ext == ".sgf";
+    }
+
+    bool ListSgfFiles (const string& dir_name, vector <string>* files) {
+#ifdef _MSC_VER
+      return false;
+#else
+      DIR* dir = opendir (dir_name.c_str ());
+      if (dir == NULL) return false;
+      while (dirent* entry = readdir (dir)) {
+        string name = entry->d_name;
+        if (name == "." || name == "..") continue;
+        string path = dir_name + "/" + name;
+        struct stat st;
+        if (stat (path.c_str (), &st) != 0) continue;
+        if (S_ISDIR (st.st_mode)) {
+          ListSgfFiles (path, files);
+        } else if (HasSgfExtension (name)) {
+          files->push_back (path);
+        }
+      }
+      closedir (dir);
+      return true;
+#endif
+    }
+
+    struct SgfFilter {
+      bool check_rank;
+      int min_rank;
+    };
+
+    SgfResult ReadSgfFile (const string& file_name, const SgfFilter& filter,
+                           Board* board, vector <Move>* moves) {
+      ifstream in (file_name.c_str ());
+      if (!in) return kSgfBad;
+      Sgf::Game game;
+      // Coordinates of larger boards make ReadGame fail after SZ is read.
+      bool ok = Sgf::ReadGame (in, &game);
+      if (game.board_size == 0) return kSgfBad;
+      if (game.board_size != board_size) return kSgfSize;
+      if (!ok) return kSgfBad;
+
+      if (filter.check_rank) {
+        int black;
+        int white;
+        if (!Sgf::RankOfString (game.black_rank, &black) ||
+            !Sgf::RankOfString (game.white_rank, &white) ||
+            black < filter.min_rank || white < filter.min_rank) {
+          return kSgfRank;
+        }
+      }
+
+      // Setup stones are not moves, the corpus has no place for them.
+      if (game.setup_count > 0) return kSgfSetup;
+
+      board->Clear ();
+      rep (ii, game.moves.size ()) {
+        if (!board->IsLegal (game.moves [ii])) return kSgfIllegal;
+        board->PlayLegal (game.moves [ii]);
+      }
+      moves->swap (game.moves);
+      return kSgfOk;
+    }
+
+    // Slots of file ii are at ii % kSgfWindow.
+    struct SgfQueue {
+      const vector <string>* files;
+      const SgfFilter* filter;
+      vector <vector <Move> > games;
+      vector <SgfResult> results;
+      vector <bool> done;
+      uint next;     // first file not taken by a worker
+      uint written;  // first file not taken by the writer
+
+      std::mutex mutex;
+      std::condition_variable file_done;
+      std::condition_variable window_moved;
+    };
+
+    void SgfWorker (SgfQueue* queue) {
+      Board board;
+      vector <Move> moves;
+      std::unique_lock <std::mutex> lock (queue->mutex);
+      while (true) {
+        while (queue->next < queue->files->size () &&
+               queue->next >= queue->written + kSgfWindow) {
+          queue->window_moved.wait (lock);
+        }
+        if (queue->next >= queue->files->size ()) return;
+        uint ii = queue->next++;
+        lock.unlock ();
+
+        SgfResult result =
+          ReadSgfFile ((*queue->files) [ii], *queue->filter, &board, &moves);
+
+        lock.lock ();
+        uint slot = ii % kSgfWindow;
+        queue->games [slot].swap (moves);
+        queue->results [slot] = result;
+        queue->done [slot] = true;
+        queue->file_done.notify_all ();
+      }
+    }
+  }
+
+  string SgfStats::ToString () const {
+    ostringstream out;
+    out
+      << file_count << " files, "
+      << game_count << " games, "
+      << move_count << " moves written" << endl
+      << "skipped: "
+      << bad_count << " unreadable, "
+      << size_count << " other size, "
+      << rank_count << " rank, "
+      << setup_count << " setup stones, "
+      << illegal_count << " illegal" << endl
+      << fixed << setprecision (1)
+      << seconds << " s, "
+      << file_count / max (seconds, 1e-9) << " files/s, "
+      << move_count / max (seconds, 1e-9) << " moves/s";
+    return out.str ();
+  }
+
+  bool ConvertSgf (const string& dir_name, const string& out_file_name,
+                   const string& min_rank, uint thread_count,
+                   SgfStats* stats, string* error)
+  {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+    memset (stats, 0, sizeof (*stats));
+
+    SgfFilter filter;
+    filter.check_rank = min_rank != "";
+    filter.min_rank = 0;
+    if (filter.check_rank && !Sgf::RankOfString (min_rank, &filter.min_rank)) {
+      *error = "bad rank: " + min_rank;
+      return false;
+    }
+
+    vector <string> files;
+    if (!ListSgfFiles (dir_name, &files)) {
+      *error = "can't list " + dir_name;
+      return false;
+    }
+    sort (files.begin (), files.end ());
+
+    Writer writer;
+    if (!writer.Open (out_file_name)) {
+      *error = "can't open " + out_file_name;
+      return false;
+    }
+
+    SgfQueue queue;
+    queue.files = &files;
+    queue.filter = &filter;
+    queue.games.resize (kSgfWindow);
+    queue.results.assign (kSgfWindow, kSgfBad);
+    queue.done.assign (kSgfWindow, false);
+    queue.next = 0;
+    queue.written = 0;
+
+    vector <thread> threads;
+    rep (ii, max (thread_count, 1u)) threads.push_back (thread (SgfWorker, &queue));
+
+    vector <Move> moves;
+    rep (ii, files.size ()) {
+      SgfResult result;
+      {
+        std::unique_lock <std::mutex> lock (queue.mutex);
+        uint slot = ii % kSgfWindow;
+        while (!queue.done [slot]) queue.file_done.wait (lock);
+        moves.swap (queue.games [slot]);
+        result = queue.results [slot];
+        queue.done [slot] = false;
+        queue.written = ii + 1;
+        queue.window_moved.notify_all ();
+      }
+
+      switch (result) {
+      case kSgfOk:
+        writer.Add (moves);
+        stats->game_count += 1;
+        stats->move_count += moves.size ();
+        break;
+      case kSgfBad:     stats->bad_count += 1; break;
+      case kSgfSize:    stats->size_count += 1; break;
+      case kSgfRank:    stats->rank_count += 1; break;
+      case kSgfSetup:   stats->setup_count += 1; break;
+      case kSgfIllegal: stats->illegal_count += 1; break;
+      }
+      stats->file_count += 1;
+    }
+    rep (ii, threads.size ()) threads [ii].join ();
+
+    stats->seconds =
+      chrono::duration <double> (chrono::steady_clock::now () - start).count ();
+    if (!writer.Close ()) {
+      *error = "can't write " + out_file_name;
+      return false;
+    }
+    return true;
+  }
+}
@@ -0,0 +1,101 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#ifndef GAME_CORPUS_H_
+#define GAME_CORPUS_H_
+
+#include <stdint.h>
+#include <cstdio>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "move.hpp"
+
+// Binary file of game records, read through mmap.
+//
+// Layout (native byte order):
+//   header   "EGOGAMES", uint32 version, uint32 board_size,
+//            uint64 game_count, uint64 move_count, uint64 index_offset
+//   moves    uint16 per move: player << 15 | (row * board_size + column),
+//            pass is 0x7fff in the low bits
+//   index    at index_offset, game_count + 1 uint64 offsets of the first
+//            move of every game and of the end of moves
+namespace GameCorpus {
+
+  class Writer {
+  public:
+    Writer ();
+    ~Writer ();
+
+    bool Open (const string& file_name);
+    void Add (const vector <Move>& moves);
+    // Writes the index and the header. Returns false on a write error.
+    bool Close ();
+
+    uint64 GameCount () const;
+
+  private:
+    FILE* file;
+    vector <uint64> offsets;
+    uint64 move_count;
+    bool ok;
+  };
+
+  class Reader {
+  public:
+    Reader ();
+    ~Reader ();
+
+    // Maps the file and checks the header, the index and the move codes.
+    bool Open (const string& file_name, string* error);
+    void Close ();
+
+    uint64 GameCount () const;
+    uint64 TotalMoveCount () const;
+    uint MoveCount (uint64 game) const;
+    Move GetMove (uint64 game, uint ii) const;
+    vector <Move> GetGame (uint64 game) const;
+
+  private:
+    const char* data;
+    size_t size;
+    const uint16_t* moves;
+    const uint64* index;
+    uint64 game_count;
+    uint64 move_count;
+  };
+
+  // Reads games in mm_train text format:
+  //   file <name>
+  //   <board size> <move count> <color vertex>*
+  // and writes those of the compiled board size to out_file_name.
+  bool ConvertText (istream& in, const string& out_file_name,
+                    uint64* game_count, string* error);
+
+  struct SgfStats {
+    uint64 file_count;
+    uint64 game_count;   // written
+    uint64 move_count;   // written
+    uint64 bad_count;    // unreadable or not SGF
+    uint64 size_count;   // other board size
+    uint64 rank_count;   // a player below min_rank or without a rank
+    uint64 setup_count;  // with setup stones (AB, AW), e.g. handicap
+    uint64 illegal_count;
+    double seconds;
+
+    string ToString () const;
+  };
+
+  // Converts the first game of every *.sgf file under dir_name
+  // (recursively, in file name order) on thread_count threads. Skips games
+  // of other board sizes, with setup stones, with an illegal move, and if
+  // min_rank is not "", with either player ranked below it
+  // (see Sgf::RankOfString). So the corpus holds only played moves.
+  bool ConvertSgf (const string& dir_name, const string& out_file_name,
+                   const string& min_rank, uint thread_count,
+                   SgfStats* stats, string* error);
+}
+
+#endif
@@ -0,0 +1,184 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#include <cstring>
+#include <fstream>
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "gammas.hpp"
+
+namespace {
+  const char kGammasMagic [8] = { 'E', 'G', 'O', 'G', 'A', 'M', 'M', 'A' };
+  const uint32_t kGammasVersion = 1;
+
+  struct GammasHeader {
+    char magic [8];
+    uint32_t version;
+    uint32_t hash_count;
+    uint64 checksum;
+    uint64 table_offset;
+  };
+
+  // FNV-1a over 64-bit words.
+  uint64 Checksum (const void* data, size_t size) {
+    const uint64* words = static_cast <const uint64*> (data);
+    uint64 hash = 14695981039346656037ULL;
+    rep (ii, size / sizeof (uint64)) {
+      hash ^= words [ii];
+      hash *= 1099511628211ULL;
+    }
+    return hash;
+  }
+}
+
+
+Gammas::Tab& Gammas::Owned () {
+  Unmap ();
+  if (owned == NULL) owned = new Tab;
+  gammas = owned;
+  return *owned;
+}
+
+
+void Gammas::Unmap () {
+  if (map == NULL) return;
+#ifdef _MSC_VER
+  delete [] map;
+#else
+  munmap (const_cast <char*> (map), map_size);
+#endif
+  map = NULL;
+  map_size = 0;
+  gammas = owned;
+}
+
+
+bool Gammas::ReadBinary (const string& file_name, string* error) {
+  const char* data;
+  size_t size;
+
+#ifdef _MSC_VER
+  // No mmap, the file is read into memory.
+  ifstream in (file_name.c_str (), ifstream::binary);
+  if (!in) {
+    *error = "can't open " + file_name;
+    return false;
+  }
+  in.seekg (0, ifstream::end);
+  size = size_t (in.tellg ());
+  in.seekg (0, ifstream::beg);
+  char* buffer = new char [size];
+  in.read (buffer, size);
+  if (!in) {
+    delete [] buffer;
+    *error = "can't read " + file_name;
+    return false;
+  }
+  data = buffer;
+#else
+  int fd = open (file_name.c_str (), O_RDONLY);
+  if (fd < 0) {
+    *error = "can't open " + file_name;
+    return false;
+  }
+  struct stat st;
+  if (fstat (fd, &st) != 0 || st.st_size < off_t (sizeof (GammasHeader))) {
+    close (fd);
+    *error = file_name + " is not a binary gamma file";
+    return false;
+  }
+  size = st.st_size;
+  // Shared, so all processes mapping the file use the same pages.
+  void* mapped = mmap (NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+  if (mapped == MAP_FAILED) {
+    *error = "can't map " + file_name;
+    return false;
+  }
+  data = static_cast <const char*> (mapped);
+#endif
+
+  // Validated before the current table is dropped.
+  string problem;
+  GammasHeader header;
+  if (size < sizeof (header)) {
+    problem = file_name + " is not a binary gamma file";
+  } else {
+    memcpy (&header, data, sizeof (header));
+    if (memcmp (header.magic, kGammasMagic, sizeof (kGammasMagic)) != 0) {
+      problem = file_name + " is not a binary gamma file";
+    } else if (header.version != kGammasVersion) {
+      problem = file_name + ": unsupported version " + ToString (header.version);
+    } else if (header.hash_count != Hash3x3::kBound ||
+               header.table_offset % sizeof (double) != 0 ||
+               header.table_offset < sizeof (header) ||
+               header.table_offset + sizeof (Tab) != size) {
+      problem = file_name + ": truncated or corrupted";
+    } else if (Checksum (data + header.table_offset, sizeof (Tab)) != header.checksum) {
+      problem = file_name + ": bad checksum";
+    }
+  }
+  if (!problem.empty ()) {
+#ifdef _MSC_VER
+    delete [] data;
+#else
+    munmap (const_cast <char*> (data), size);
+#endif
+    *error = problem;
+    return false;
+  }
+
+  Unmap ();
+  delete owned;
+  owned = NULL;
+  map = data;
+  map_size = size;
+  gammas = reinterpret_cast <const Tab*> (data + header.table_offset);
+  return true;
+}
+
+
+bool Gammas::WriteBinary (const string& file_name) const {
+  GammasHeader header;
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, kGammasMagic, sizeof (kGammasMagic));
+  header.version = kGammasVersion;
+  header.hash_count = Hash3x3::kBound;
+  header.checksum = Checksum (gammas, sizeof (Tab));
+  header.table_offset = sizeof (header);
+
+  ofstream out (file_name.c_str (), ofstream::binary);
+  out.write (reinterpret_cast <const char*> (&header), sizeof (header));
+  out.write (reinterpret_cast <const char*> (gammas), sizeof (Tab));
+  out.close ();
+  return bool (out);
+}
+
+
+bool Gammas::Load (const string& file_name, string* error) {
+  ifstream in (file_name.c_str (), ifstream::binary);
+  if (!in.good ()) {
+    *error = "Can't open a file: " + file_name;
+    return false;
+  }
+  char magic [sizeof (kGammasMagic)] = {};
+  in.read (magic, sizeof (magic));
+  if (in && memcmp (magic, kGammasMagic, sizeof (magic)) == 0) {
+    return ReadBinary (file_name, error);
+  }
+
+  in.clear ();
+  in.seekg (0, ifstream::beg);
+  if (!Read (in)) {
+    *error = "File in a bad format.";
+    return false;
+  }
+  return true;
+}
@@ -1,6 +1,8 @@
 #ifndef _GAMMAS_HPP
 #define _GAMMAS_HPP
 
+#include <string>
+
 #include "hash.hpp"
 
 const double GammaskAccurancy = 1.0e-10;
@@ -9,28 +11,30 @@ const double GammaskAccurancy = 1.0e-10;
 
 class Gammas {
 public:
-  Gammas () {
-    gammas = new Tab;
+  Gammas () : owned (NULL), gammas (NULL), map (NULL), map_size (0) {
     ResetToUniform ();
   }
 
   ~Gammas () {
-    delete gammas;
+    Unmap ();
+    delete owned;
   }
 
   void ZeroAllGammas () {
+    Tab& tab = Owned ();
     ForEachNat (Hash3x3, hash) {
       ForEachNat (Player, pl) {
-        (*gammas) [hash] [pl] = 0.0;
+        tab [hash] [pl] = 0.0;
       }
     }
   }
 
 
   void ResetToUniform () {
+    Tab& tab = Owned ();
     ForEachNat (Hash3x3, hash) {
       ForEachNat (Player, pl) {
-        (*gammas) [hash] [pl] = 
+        tab [hash] [pl] = 
           (hash.IsLegal (pl) && !hash.IsEyelike (pl))
           ? 1.0
           : 0.0;
@@ -40,36 +44,29 @@ public:
 
 
   bool Read (istream& in) {
+    const Hash3x3Table& table = Hash3x3Table::Get ();
+    vector <double> values (Hash3x3Table::kCanonicalCount, 0.0);
     uint raw_hash;
     double value;
     string c;
 
-    ZeroAllGammas ();
-
-    rep (ii, 2051) {
+    rep (ii, Hash3x3Table::kCanonicalCount) {
       in >> raw_hash >> c >> value;
       
-      if (!in || c != ",") {
+      if (!in || c != "," || raw_hash >= Hash3x3::kBound) {
         ResetToUniform ();
         cerr << "Error at:" << ii << endl;
         return false;
       }
       
-      Hash3x3 all[8];
-      Hash3x3::OfRaw (raw_hash).GetAll8Symmetries (all);
-      rep (ii, 8) {
-        Hash3x3 hash = all[ii];
-        CHECK (value > 0.0);
-        CHECK (hash.IsLegal (Player::Black ()));
-        CHECK (value > GammaskAccurancy * 100);
-
-        // Note: We zero values of play-in-eye
-        if (!hash.IsEyelike (Player::Black())) {
-          (*gammas) [hash] [Player::Black()] = value;
-          hash = hash.InvertColors ();
-          (*gammas) [hash] [Player::White()] = value;
-        }
+      // Impossible or illegal patterns and tiny gammas are format errors too.
+      uint index = table.Index (Hash3x3::OfRaw (raw_hash));
+      if (index == Hash3x3Table::kNoIndex || !(value > GammaskAccurancy * 100)) {
+        ResetToUniform ();
+        cerr << "Error at:" << ii << endl;
+        return false;
       }
+      values [index] = value;
     }
     // check that nothing more can be read
     in >> raw_hash;
@@ -77,10 +74,34 @@ public:
       ResetToUniform ();
       return false;
     }
+
+    ZeroAllGammas ();
+    Tab& tab = Owned ();
+    ForEachNat (Hash3x3, hash) {
+      uint index = table.Index (hash);
+      // Note: We zero values of play-in-eye
+      if (index == Hash3x3Table::kNoIndex || hash.IsEyelike (Player::Black())) {
+        continue;
+      }
+      tab [hash] [Player::Black()] = values [index];
+      tab [hash.InvertColors ()] [Player::White()] = values [index];
+    }
     return true;
   }
 
 
+  // Binary format: the expanded table, mapped read-only so that engines
+  // on one host share a single copy. Layout (native byte order):
+  //   header  "EGOGAMMA", uint32 version, uint32 hash count,
+  //           uint64 checksum of the table, uint64 table offset
+  //   table   hash count * 2 doubles, gamma of black and white per hash
+  bool ReadBinary (const std::string& file_name, std::string* error);
+  bool WriteBinary (const std::string& file_name) const;
+
+  // Reads either format, told apart by the magic.
+  bool Load (const std::string& file_name, std::string* error);
+
+
   double Get (Hash3x3 hash, Player pl) const {
     return (*gammas) [hash] [pl];
   }
@@ -88,7 +109,15 @@ public:
 private:
 
   typedef NatMap<Hash3x3, NatMap<Player, double> > Tab;
-  Tab* gammas;
+
+  // The heap table, allocated (and any mapping dropped) for writing.
+  Tab& Owned ();
+  void Unmap ();
+
+  Tab* owned;
+  const Tab* gammas;   // owned or mapped
+  const char* map;
+  size_t map_size;
 };
 
 #endif
@@ -54,3 +54,128 @@ Hash Zobrist::OfMove (Move m) const {
 Hash Zobrist::OfPlayerVertex (Player pl,  Vertex v) const {
   return hashes [Move (pl, v)];
 }
+
+// -----------------------------------------------------------------------------
+
+namespace {
+  bool ComputeIsLegal (Hash3x3 hash, Player pl) {
+    NatMap <Color, uint> color_cnt(0);
+    NatMap <Player, uint> atari_cnt(0);
+
+    ForEachNat (Dir, dir) {
+      if (!dir.IsSimple4()) continue;
+      Color c = hash.ColorAt (dir);
+      color_cnt [c] += 1;
+      if (c.IsPlayer() && hash.IsInAtari(dir)) atari_cnt [c.ToPlayer()] += 1;
+    }
+
+    if (color_cnt [Color::Empty()] > 0) return true;
+    if (atari_cnt [pl.Other()] > 0) return true;
+    if (atari_cnt [pl] < color_cnt [Color::OfPlayer(pl)]) return true;
+    return false;
+  }
+
+
+  bool ComputeIsEyelike (Hash3x3 hash, Player pl) {
+    NatMap <Color, uint> color_cnt(0);
+    NatMap <Color, uint> diag_color_cnt(0);
+    ForEachNat (Dir, dir) {
+      if (dir.IsSimple4()) {
+        color_cnt [hash.ColorAt (dir)] += 1;
+      } else {
+        diag_color_cnt [hash.ColorAt (dir)] += 1;
+      }
+    }
+
+    if (color_cnt [Color::OfPlayer(pl)] + color_cnt [Color::OffBoard()] < 4) {
+      return false;
+    }
+
+    return
+      diag_color_cnt [Color::OfPlayer (pl.Other())] +
+      (diag_color_cnt [Color::OffBoard ()] > 0) < 2;
+  }
+
+
+  bool ComputeIsPossible (Hash3x3 hash) {
+    // The 8 neighbours clockwise, each adjacent to the next. Even
+    // positions are N, E, S, W.
+    const Dir ring [8] = {
+      Dir::N (), Dir::NE (), Dir::E (), Dir::SE (),
+      Dir::S (), Dir::SW (), Dir::W (), Dir::NW ()
+    };
+    Color color [8];
+    rep (ii, 8) color [ii] = hash.ColorAt (ring [ii]);
+
+    rep (ii, 8) {
+      bool off = color [ii] == Color::OffBoard ();
+      bool prev_off = color [(ii + 7) % 8] == Color::OffBoard ();
+      bool next_off = color [(ii + 1) % 8] == Color::OffBoard ();
+      if (ii % 2 == 0) {
+        // A side is off-board whole and not with the opposite one.
+        if (off && !(prev_off && next_off)) return false;
+        if (off && color [(ii + 4) % 8] == Color::OffBoard ()) return false;
+        if (hash.IsInAtari (ring [ii]) && !color [ii].IsPlayer ()) return false;
+      } else {
+        if (off && !prev_off && !next_off) return false;
+      }
+    }
+
+    rep (ii, 8) {
+      if (ii % 2 != 0 || !color [ii].IsPlayer ()) continue;
+      // Stones connected to ring [ii] within the ring.
+      uint first = 0;
+      while (first < 7 && color [(ii + 7 - first) % 8] == color [ii]) first += 1;
+      uint last = 0;
+      while (last < 7 && color [(ii + last + 1) % 8] == color [ii]) last += 1;
+      bool atari = hash.IsInAtari (ring [ii]);
+      if (first + last >= 7) {
+        first = 7;
+        last = 0;
+      }
+      reps (jj, -int (first), int (last) + 1) {
+        uint kk = (ii + 8 + jj) % 8;
+        if (kk % 2 == 0 && hash.IsInAtari (ring [kk]) != atari) return false;
+      }
+      // The center is the only liberty of a chain in atari.
+      if (atari && first + last < 7) {
+        if (color [(ii + 7 - first) % 8] == Color::Empty ()) return false;
+        if (color [(ii + last + 1) % 8] == Color::Empty ()) return false;
+      }
+    }
+    return true;
+  }
+}
+
+
+const Hash3x3Table& Hash3x3Table::Get () {
+  static const Hash3x3Table table;
+  return table;
+}
+
+
+Hash3x3Table::Hash3x3Table () : index (kNoIndex), flags (0) {
+  ForEachNat (Hash3x3, hash) {
+    uint f = ComputeIsPossible (hash) << kPossible;
+    ForEachNat (Player, pl) {
+      f |= ComputeIsLegal (hash, pl) << (kLegal + pl.GetRaw ());
+      f |= ComputeIsEyelike (hash, pl) << (kEyelike + pl.GetRaw ());
+    }
+    flags [hash] = f;
+  }
+
+  // Raw hashes ascend, so a class is first met at its smallest member.
+  uint count = 0;
+  ForEachNat (Hash3x3, hash) {
+    if (index [hash] != kNoIndex) continue;
+    if (!IsPossible (hash) || !IsLegal (hash, Player::Black ())) continue;
+    Hash3x3 all[8];
+    hash.GetAll8Symmetries (all);
+    CHECK (all [0] == hash);
+    CHECK (count < kCanonicalCount);
+    rep (ii, 8) index [all [ii]] = count;
+    canonical [count] = hash;
+    count += 1;
+  }
+  CHECK (count == kCanonicalCount);
+}
@@ -5,6 +5,8 @@
 #ifndef HASH_H_
 #define HASH_H_
 
+#include <stdint.h>
+
 #include "utils.hpp"
 #include "fast_random.hpp"
 #include "move.hpp"
@@ -102,43 +104,9 @@ public:
   }
 
 
-  bool IsLegal (Player pl) {
-    NatMap <Color, uint> color_cnt(0);
-    NatMap <Player, uint> atari_cnt(0);
-
-    ForEachNat (Dir, dir) {
-      if (!dir.IsSimple4()) continue;
-      Color c = ColorAt (dir);
-      color_cnt [c] += 1;
-      if (c.IsPlayer() && IsInAtari(dir)) atari_cnt [c.ToPlayer()] += 1;
-    }
-
-    if (color_cnt [Color::Empty()] > 0) return true;
-    if (atari_cnt [pl.Other()] > 0) return true;
-    if (atari_cnt [pl] < color_cnt [Color::OfPlayer(pl)]) return true;
-    return false;
-  }
-
-
-  bool IsEyelike (Player pl) const {
-    NatMap <Color, uint> color_cnt(0);
-    NatMap <Color, uint> diag_color_cnt(0);
-    ForEachNat (Dir, dir) {
-      if (dir.IsSimple4()) {
-        color_cnt [ColorAt (dir)] += 1;
-      } else {
-        diag_color_cnt [ColorAt (dir)] += 1;
-      }
-    }
-    
-    if (color_cnt [Color::OfPlayer(pl)] + color_cnt [Color::OffBoard()] < 4) {
-      return false;
-    }
-
-    return
-      diag_color_cnt [Color::OfPlayer (pl.Other())] +
-      (diag_color_cnt [Color::OffBoard ()] > 0) < 2;
-  }
+  // Lookups in Hash3x3Table.
+  bool IsLegal (Player pl) const;
+  bool IsEyelike (Player pl) const;
 
 
   // bits from oldest:
@@ -253,4 +221,65 @@ private:
   explicit Hash3x3 (uint raw) : Nat <Hash3x3> (raw) {}
 };
 
+// -----------------------------------------------------------------------------
+
+// Properties of all 2^20 hashes, computed once by enumeration.
+// A hash is possible if it can be seen around an empty vertex of a board:
+// off-board neighbours form whole sides, only stones have atari bits and
+// stones connected within the 3x3 share theirs, a stone in atari has no
+// other empty neighbour. Possible hashes legal for black fall into
+// kCanonicalCount symmetry classes, indexed in the order of their smallest
+// member.
+class Hash3x3Table {
+public:
+  static const uint kCanonicalCount = 2051;
+  static const uint kNoIndex = 0xffff;
+
+  static const Hash3x3Table& Get ();
+
+  // Symmetry class of a possible hash legal for black, kNoIndex otherwise.
+  uint Index (Hash3x3 hash) const {
+    return index [hash];
+  }
+
+  // Smallest raw hash of the class.
+  Hash3x3 Canonical (uint index) const {
+    return canonical [index];
+  }
+
+  bool IsPossible (Hash3x3 hash) const {
+    return (flags [hash] >> kPossible) & 1;
+  }
+
+  bool IsLegal (Hash3x3 hash, Player pl) const {
+    return (flags [hash] >> (kLegal + pl.GetRaw ())) & 1;
+  }
+
+  bool IsEyelike (Hash3x3 hash, Player pl) const {
+    return (flags [hash] >> (kEyelike + pl.GetRaw ())) & 1;
+  }
+
+private:
+  Hash3x3Table ();
+
+  // Bits of flags.
+  static const uint kPossible = 0;
+  static const uint kLegal = 1;    // + player
+  static const uint kEyelike = 3;  // + player
+
+  NatMap <Hash3x3, uint16_t> index;
+  NatMap <Hash3x3, uint8_t> flags;
+  Hash3x3 canonical [kCanonicalCount];
+};
+
+
+inline bool Hash3x3::IsLegal (Player pl) const {
+  return Hash3x3Table::Get ().IsLegal (*this, pl);
+}
+
+
+inline bool Hash3x3::IsEyelike (Player pl) const {
+  return Hash3x3Table::Get ().IsEyelike (*this, pl);
+}
+
 #endif
@@ -0,0 +1,169 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#include <algorithm>
+#include <iomanip>
+
+#include "microbenchmark.hpp"
+
+#include "fast_timer.hpp"
+#include "utils.hpp"
+
+namespace Microbenchmark {
+
+  namespace {
+    // Board before a move and the move played in the playout.
+    struct Position {
+      Board board;
+      Move move;
+    };
+
+    Gammas gammas;
+
+    // Every 7th position of seeded playouts, including the final ones.
+    vector <Position> CapturePositions (uint count) {
+      vector <Position> positions;
+      positions.reserve (count);
+      Board board;
+      Sampler sampler (board, gammas);
+      FastRandom random (123);
+
+      while (positions.size () < count) {
+        board.Clear ();
+        sampler.NewPlayout ();
+        while (!board.BothPlayerPass () && positions.size () < count) {
+          Player pl = board.ActPlayer ();
+          Vertex v = sampler.SampleMove (random);
+          if (board.MoveCount () % 7 == 0 || v == Vertex::Pass ()) {
+            positions.push_back (Position ());
+            positions.back ().board.Load (board);
+            positions.back ().move = Move (pl, v);
+          }
+          board.PlayLegal (pl, v);
+          sampler.MovePlayed ();
+        }
+      }
+      return positions;
+    }
+
+    // Cycles per call of one primitive, one sample per position.
+    class Samples {
+    public:
+      explicit Samples (const string& name) : name (name) {}
+
+      void Add (double cycles) { samples.push_back (cycles); }
+
+      string ToString () {
+        sort (samples.begin (), samples.end ());
+        double sum = 0.0;
+        rep (ii, samples.size ()) sum += samples [ii];
+        ostringstream out;
+        out << setw (22) << left << name << right << fixed << setprecision (1)
+            << setw (9) << sum / samples.size ()
+            << setw (9) << Percentile (0.10)
+            << setw (9) << Percentile (0.50)
+            << setw (9) << Percentile (0.90)
+            << setw (9) << Percentile (0.99) << endl;
+        return out.str ();
+      }
+
+    private:
+      double Percentile (double p) const {
+        return samples [min <size_t> (samples.size () - 1, p * samples.size ())];
+      }
+
+      string name;
+      vector <double> samples;
+    };
+  }
+
+  string Run (uint position_count) {
+    vector <Position> positions = CapturePositions (max (position_count, 1u));
+    FastTimer timer;
+    Board board;
+    Sampler sampler (board, gammas);
+    FastRandom random (123);
+    uint64 sink = 0; // keeps results alive
+
+    Samples load ("RawBoard::Load");
+    Samples play ("RawBoard::PlayLegal");
+    Samples is_legal ("RawBoard::IsLegal");
+    Samples is_eyelike ("RawBoard::IsEyelike");
+    Samples playout_score ("PlayoutScore");
+    Samples tromp_taylor ("TrompTaylorScore");
+    Samples new_playout ("Sampler::NewPlayout");
+    Samples move_played ("Sampler::MovePlayed");
+    Samples sample_move ("Sampler::SampleMove");
+
+    rep (ii, positions.size ()) {
+      const Board& pos = positions [ii].board;
+      Move m = positions [ii].move;
+      Player pl = pos.ActPlayer ();
+      uint empty_cnt = max (pos.EmptyVertexCount (), 1u);
+
+      timer.Start ();
+      board.RawBoard::Load (pos);
+      timer.Stop ();
+      load.Add (timer.LastTicks ());
+
+      timer.Start ();
+      rep (jj, pos.EmptyVertexCount ()) sink += pos.IsLegal (pl, pos.EmptyVertex (jj));
+      timer.Stop ();
+      is_legal.Add (timer.LastTicks () / empty_cnt);
+
+      timer.Start ();
+      rep (jj, pos.EmptyVertexCount ()) sink += pos.IsEyelike (pl, pos.EmptyVertex (jj));
+      timer.Stop ();
+      is_eyelike.Add (timer.LastTicks () / empty_cnt);
+
+      timer.Start ();
+      sink += pos.PlayoutScore ();
+      timer.Stop ();
+      playout_score.Add (timer.LastTicks ());
+
+      timer.Start ();
+      sink += pos.TrompTaylorScore ();
+      timer.Stop ();
+      tromp_taylor.Add (timer.LastTicks ());
+
+      timer.Start ();
+      sampler.NewPlayout ();
+      timer.Stop ();
+      new_playout.Add (timer.LastTicks ());
+
+      timer.Start ();
+      sink += sampler.SampleMove (random).GetRaw ();
+      timer.Stop ();
+      sample_move.Add (timer.LastTicks ());
+
+      timer.Start ();
+      board.RawBoard::PlayLegal (m.GetPlayer (), m.GetVertex ());
+      timer.Stop ();
+      play.Add (timer.LastTicks ());
+
+      timer.Start ();
+      sampler.MovePlayed ();
+      timer.Stop ();
+      move_played.Add (timer.LastTicks ());
+    }
+
+    ostringstream out;
+    out << endl << positions.size () << " positions, cycles per call"
+        << " (timer overhead " << timer.overhead << " subtracted)" << endl
+        << setw (22) << left << "" << right
+        << setw (9) << "mean" << setw (9) << "p10" << setw (9) << "p50"
+        << setw (9) << "p90" << setw (9) << "p99" << endl
+        << load.ToString ()
+        << play.ToString ()
+        << is_legal.ToString ()
+        << is_eyelike.ToString ()
+        << playout_score.ToString ()
+        << tromp_taylor.ToString ()
+        << new_playout.ToString ()
+        << move_played.ToString ()
+        << sample_move.ToString ()
+        << "checksum " << sink % 1000 << endl;
+    return out.str ();
+  }
+}
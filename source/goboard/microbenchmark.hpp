@@ -0,0 +1,20 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#ifndef MICROBENCHMARK_H_
+#define MICROBENCHMARK_H_
+
+#include <string>
+
+#include "board.hpp"
+
+// Times single RawBoard and Sampler operations in isolation.
+// Inputs are positions captured from seeded sampler playouts.
+// Each primitive is reported as FastTimer cycles per call: mean and
+// percentiles over the positions.
+namespace Microbenchmark {
+  string Run (uint position_count);
+}
+
+#endif
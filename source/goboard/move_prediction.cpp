@@ -0,0 +1,126 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+
+#include "move_prediction.hpp"
+#include "board.hpp"
+#include "sampler.hpp"
+
+namespace MovePrediction {
+
+  namespace {
+    double SecondsSince (chrono::steady_clock::time_point time) {
+      return chrono::duration <double> (chrono::steady_clock::now () - time).count ();
+    }
+
+    // Adds to hits the chance that played is among the k best of gamma
+    // for every k. NaN gammas are illegal or never played moves; a
+    // played move of NaN gamma ranks after all the others.
+    void AddHits (const NatMap <Vertex, double>& gamma, Vertex played,
+                  vector <double>* hits) {
+      double played_gamma = gamma [played];
+      uint better = 0;
+      uint ties = 0;
+      ForEachNat (Vertex, v) {
+        if (v == played || !v.IsOnBoard () || isnan (gamma [v])) continue;
+        if (isnan (played_gamma) || gamma [v] > played_gamma) better += 1;
+        if (gamma [v] == played_gamma) ties += 1;
+      }
+      // The played move is uniformly at ranks better + 1 .. better + ties + 1.
+      rep (k, hits->size ()) {
+        double in_top = double (k + 1) - better;
+        (*hits) [k] += max (0.0, min (1.0, in_top / (ties + 1)));
+      }
+    }
+  }
+
+  string Result::ToString () const {
+    ostringstream out;
+    out << fixed << setprecision (1)
+        << game_count << " games, "
+        << position_count << " positions, "
+        << illegal_count << " cut at an illegal move" << endl;
+    rep (k, hits.size ()) {
+      out << "top-" << k + 1 << " "
+          << 100.0 * hits [k] / max (position_count, uint64 (1)) << "%"
+          << (k + 1 == hits.size () ? "" : ", ");
+    }
+    uint64 scored = position_count - zero_count;
+    out << endl << setprecision (4)
+        << "mean log p: " << log_likelihood / max (scored, uint64 (1))
+        << " (" << zero_count << " played moves of gamma 0 left out)" << endl
+        << setprecision (0)
+        << "policy: " << position_count / max (policy_seconds, 1e-9)
+        << " evaluations/s, " << setprecision (3)
+        << 1.0e6 * policy_seconds / max (position_count, uint64 (1)) << " us each";
+    return out.str ();
+  }
+
+  Result Run (const GameCorpus::Reader& corpus, const Gammas& gammas,
+              uint top_k, uint64 max_games)
+  {
+    Result result;
+    result.game_count = corpus.GameCount ();
+    if (max_games > 0) result.game_count = min (result.game_count, max_games);
+    result.position_count = 0;
+    result.illegal_count = 0;
+    result.hits.assign (top_k, 0.0);
+    result.log_likelihood = 0.0;
+    result.zero_count = 0;
+    result.policy_seconds = 0.0;
+
+    Board board;
+    Sampler sampler (board, gammas);
+    NatMap <Vertex, double> gamma;
+
+    rep (game, result.game_count) {
+      board.Clear ();
+      sampler.NewPlayout ();
+
+      rep (ii, corpus.MoveCount (game)) {
+        Move m = corpus.GetMove (game, ii);
+        Player pl = m.GetPlayer ();
+        Vertex v = m.GetVertex ();
+        if (!board.IsLegal (m)) {
+          result.illegal_count += 1;
+          break;
+        }
+        // Setup stones and handicap break the alternation.
+        bool in_turn = pl == board.ActPlayer ();
+
+        if (in_turn && v != Vertex::Pass ()) {
+          chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+          sampler.GetPatternGammas (gamma, true);
+          result.policy_seconds += SecondsSince (start);
+
+          result.position_count += 1;
+          AddHits (gamma, v, &result.hits);
+
+          double total = 0.0;
+          ForEachNat (Vertex, nbr) {
+            if (nbr.IsOnBoard () && !isnan (gamma [nbr])) total += gamma [nbr];
+          }
+          if (isnan (gamma [v])) {
+            result.zero_count += 1;
+          } else {
+            result.log_likelihood += log (gamma [v] / total);
+          }
+        }
+
+        board.PlayLegal (m);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+        if (in_turn) {
+          sampler.MovePlayed ();
+        } else {
+          sampler.NewPlayout ();
+        }
+        result.policy_seconds += SecondsSince (start);
+      }
+    }
+    return result;
+  }
+}
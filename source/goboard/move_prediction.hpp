@@ -0,0 +1,41 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#ifndef MOVE_PREDICTION_H_
+#define MOVE_PREDICTION_H_
+
+#include <string>
+#include <vector>
+
+#include "game_corpus.hpp"
+#include "gammas.hpp"
+
+// How well the playout policy predicts moves of held-out games and how
+// fast it is. Games are replayed with a Sampler; in every position the
+// legal moves are ranked by their policy gamma (3x3 pattern with the
+// proximity bonus) and the rank of the played move is recorded.
+namespace MovePrediction {
+
+  struct Result {
+    uint64 game_count;
+    uint64 position_count;   // non-pass moves of the player to move
+    uint64 illegal_count;    // games cut at an illegal move
+
+    // hits [k - 1] is the expected number of positions with the played
+    // move among the k best, ties broken at random, gamma 0 ranked last.
+    vector <double> hits;
+    double log_likelihood;   // sum of log of the played move's probability
+    uint64 zero_count;       // played moves of gamma 0, left out of it
+
+    double policy_seconds;   // in Sampler::MovePlayed and gamma lookups
+
+    string ToString () const;
+  };
+
+  // Replays games [0, max_games) of the corpus (all if max_games is 0).
+  Result Run (const GameCorpus::Reader& corpus, const Gammas& gammas,
+              uint top_k, uint64 max_games);
+}
+
+#endif
@@ -0,0 +1,130 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#include <chrono>
+#include <iomanip>
+
+#include "perft.hpp"
+
+namespace Perft {
+
+  namespace {
+    uint64 HashValue (const Hash& hash) {
+      return uint64 (hash.Lock ()) << 32 | hash.Index ();
+    }
+
+    void Copy (RawBoard* board, const RawBoard& other) {
+      board->Load (other);
+    }
+
+    void Copy (ReferenceBoard* board, const ReferenceBoard& other) {
+      *board = other;
+    }
+
+    // boards [ply] is the current position, deeper entries are scratch.
+    template <typename B>
+    void Enumerate (B* boards, uint ply, uint depth, Count* count) {
+      const B& board = boards [ply];
+      count->nodes += 1;
+      if (ply == depth || board.BothPlayerPass ()) {
+        count->leaves += 1;
+        count->checksum += HashValue (board.PositionalHash ());
+        return;
+      }
+      Player pl = board.ActPlayer ();
+      B& next = boards [ply + 1];
+      ForEachNat (Vertex, v) {
+        if (v != Vertex::Pass () && !v.IsOnBoard ()) continue;
+        if (!board.IsLegal (pl, v)) continue;
+        Copy (&next, board);
+        next.PlayLegal (pl, v);
+        Enumerate (boards, ply + 1, depth, count);
+      }
+    }
+
+    template <typename B>
+    Count EnumerateFrom (const B& board, uint depth) {
+      vector <B> boards (depth + 1);
+      Copy (&boards [0], board);
+      Count count = { 0, 0, 0 };
+      Enumerate (boards.data (), 0, depth, &count);
+      return count;
+    }
+
+    // Move lists of the positions: the empty board and prefixes of
+    // seeded sampler games, 10 to 50 moves long.
+    vector <vector <Move> > Positions (uint position_count) {
+      Gammas gammas;
+      vector <vector <Move> > positions;
+      if (position_count > 0) positions.push_back (vector <Move> ());
+      FastRandom random (123);
+      RawBoard board;
+      Sampler sampler (board, gammas);
+      while (positions.size () < position_count) {
+        uint length = 10 + 10 * (positions.size () % 5);
+        board.Clear ();
+        sampler.NewPlayout ();
+        vector <Move> moves;
+        while (moves.size () < length && !board.BothPlayerPass ()) {
+          Move m = Move (board.ActPlayer (), sampler.SampleMove (random));
+          board.PlayLegal (m);
+          sampler.MovePlayed ();
+          moves.push_back (m);
+        }
+        positions.push_back (moves);
+      }
+      return positions;
+    }
+  }
+
+  Count Enumerate (const RawBoard& board, uint depth) {
+    return EnumerateFrom (board, depth);
+  }
+
+  Count Enumerate (const ReferenceBoard& board, uint depth) {
+    return EnumerateFrom (board, depth);
+  }
+
+  string Run (uint depth, uint position_count, bool check_reference, bool* ok) {
+    vector <vector <Move> > positions = Positions (position_count);
+    ostringstream out;
+    out << endl << "position  moves        leaves           checksum" << endl;
+    *ok = true;
+    uint64 nodes = 0;
+    double seconds = 0.0;
+
+    rep (ii, positions.size ()) {
+      const vector <Move>& moves = positions [ii];
+      RawBoard board;
+      ReferenceBoard reference;
+      rep (jj, moves.size ()) {
+        board.PlayLegal (moves [jj]);
+        reference.PlayLegal (moves [jj].GetPlayer (), moves [jj].GetVertex ());
+      }
+
+      chrono::steady_clock::time_point begin = chrono::steady_clock::now ();
+      Count count = Enumerate (board, depth);
+      seconds += chrono::duration <double> (chrono::steady_clock::now () - begin).count ();
+      nodes += count.nodes;
+
+      out << setw (8) << ii << setw (7) << moves.size ()
+          << setw (14) << count.leaves << "   " << hex << setw (16)
+          << setfill ('0') << count.checksum << dec << setfill (' ');
+      if (check_reference) {
+        Count expected = Enumerate (reference, depth);
+        bool same =
+          count.leaves == expected.leaves &&
+          count.nodes == expected.nodes &&
+          count.checksum == expected.checksum;
+        out << (same ? "  reference ok" : "  REFERENCE MISMATCH");
+        if (!same) *ok = false;
+      }
+      out << endl;
+    }
+
+    out << nodes << " nodes in " << setprecision (3) << seconds << " seconds, "
+        << nodes / max (seconds, 1e-9) / 1e6 << " Mnodes/s" << endl;
+    return out.str ();
+  }
+}
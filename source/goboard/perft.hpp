@@ -0,0 +1,36 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#ifndef PERFT_H_
+#define PERFT_H_
+
+#include <string>
+
+#include "board.hpp"
+#include "reference_board.hpp"
+
+// Enumeration of all legal move sequences to a fixed depth (as perft in
+// chess). Independent of any playout policy, it gives a deterministic
+// checksum of the move generator and the raw speed of PlayLegal + Load.
+namespace Perft {
+
+  struct Count {
+    uint64 leaves;     // positions at depth (or ended by two passes)
+    uint64 nodes;      // all positions visited, including the root
+    uint64 checksum;   // sum of positional hashes of the leaves
+  };
+
+  // Moves are IsLegal moves of the player to move and pass; superko is
+  // ignored. A pass after a pass ends the game, that position is a leaf.
+  Count Enumerate (const RawBoard& board, uint depth);
+  Count Enumerate (const ReferenceBoard& board, uint depth);
+
+  // Enumerates the empty board and position_count - 1 positions of
+  // seeded sampler games, reports counts and nodes per second.
+  // With check_reference also runs ReferenceBoard and sets ok to false
+  // if any count differs.
+  string Run (uint depth, uint position_count, bool check_reference, bool* ok);
+}
+
+#endif
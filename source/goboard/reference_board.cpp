@@ -0,0 +1,248 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#include <cmath>
+
+#include "reference_board.hpp"
+
+namespace {
+  // Same order as Dir: N E S W NW NE SE SW.
+  const int kDirRow [8] = { -1,  0, 1,  0, -1, -1, 1,  1 };
+  const int kDirCol [8] = {  0,  1, 0, -1, -1,  1, 1, -1 };
+
+  const Zobrist& ReferenceZobrist () {
+    static const Zobrist zobrist;
+    return zobrist;
+  }
+}
+
+ReferenceBoard::ReferenceBoard () :
+  move_count (0),
+  last_player (Player::White ()),
+  last_play (Vertex::Any ()),
+  ko_v (Vertex::Any ()),
+  komi (6.5)
+{
+  rep (row, board_size) rep (col, board_size) grid [row][col] = Color::Empty ();
+}
+
+void ReferenceBoard::SetKomi (float new_komi) {
+  komi = new_komi;
+}
+
+Color ReferenceBoard::ColorAt (Vertex v) const {
+  return ColorAt (v.GetRow (), v.GetColumn ());
+}
+
+Color ReferenceBoard::ColorAt (int row, int col) const {
+  if (!IsOnBoard (row, col)) return Color::OffBoard ();
+  return grid [row][col];
+}
+
+bool ReferenceBoard::IsOnBoard (int row, int col) const {
+  return row >= 0 && col >= 0 && row < int (board_size) && col < int (board_size);
+}
+
+Player ReferenceBoard::ActPlayer () const {
+  return last_player.Other ();
+}
+
+uint ReferenceBoard::MoveCount () const {
+  return move_count;
+}
+
+bool ReferenceBoard::BothPlayerPass () const {
+  return
+    last_play [Player::Black ()] == Vertex::Pass () &&
+    last_play [Player::White ()] == Vertex::Pass ();
+}
+
+Vertex ReferenceBoard::KoVertex () const {
+  return ko_v;
+}
+
+uint ReferenceBoard::Liberties (int row, int col,
+                                bool chain [board_size][board_size]) const
+{
+  Color color = ColorAt (row, col);
+  bool liberty [board_size][board_size] = {};
+  vector <pair <int, int> > stack (1, make_pair (row, col));
+  chain [row][col] = true;
+  uint count = 0;
+  while (!stack.empty ()) {
+    int r = stack.back ().first;
+    int c = stack.back ().second;
+    stack.pop_back ();
+    rep (dir, 4) {
+      int nr = r + kDirRow [dir];
+      int nc = c + kDirCol [dir];
+      if (!IsOnBoard (nr, nc)) continue;
+      if (grid [nr][nc] == Color::Empty () && !liberty [nr][nc]) {
+        liberty [nr][nc] = true;
+        count += 1;
+      }
+      if (grid [nr][nc] == color && !chain [nr][nc]) {
+        chain [nr][nc] = true;
+        stack.push_back (make_pair (nr, nc));
+      }
+    }
+  }
+  return count;
+}
+
+uint ReferenceBoard::LibertiesAt (int row, int col) const {
+  bool chain [board_size][board_size] = {};
+  return Liberties (row, col, chain);
+}
+
+uint ReferenceBoard::RemoveChain (int row, int col) {
+  bool chain [board_size][board_size] = {};
+  Liberties (row, col, chain);
+  uint count = 0;
+  rep (r, board_size) rep (c, board_size) {
+    if (chain [r][c]) {
+      grid [r][c] = Color::Empty ();
+      count += 1;
+    }
+  }
+  return count;
+}
+
+bool ReferenceBoard::IsSurroundedBy (int row, int col, Color color) const {
+  rep (dir, 4) {
+    Color nbr = ColorAt (row + kDirRow [dir], col + kDirCol [dir]);
+    if (nbr != color && nbr != Color::OffBoard ()) return false;
+  }
+  return true;
+}
+
+bool ReferenceBoard::IsLegal (Player pl, Vertex v) const {
+  if (v == Vertex::Pass ()) return true;
+  if (ColorAt (v) != Color::Empty () || v == ko_v) return false;
+
+  // Play on a copy and see if the stone has liberties after captures.
+  ReferenceBoard copy = *this;
+  copy.PlayLegal (pl, v);
+  return copy.LibertiesAt (v.GetRow (), v.GetColumn ()) > 0;
+}
+
+bool ReferenceBoard::IsEyelike (Player pl, Vertex v) const {
+  int row = v.GetRow ();
+  int col = v.GetColumn ();
+  if (!IsSurroundedBy (row, col, Color::OfPlayer (pl))) return false;
+  uint opponent = 0;
+  bool edge = false;
+  reps (dir, 4, 8) {
+    Color diag = ColorAt (row + kDirRow [dir], col + kDirCol [dir]);
+    if (diag == Color::OfPlayer (pl.Other ())) opponent += 1;
+    if (diag == Color::OffBoard ()) edge = true;
+  }
+  return opponent + (edge ? 1 : 0) < 2;
+}
+
+uint ReferenceBoard::PlayLegal (Player pl, Vertex v) {
+  move_count += 1;
+  last_player = pl;
+  last_play [pl] = v;
+  ko_v = Vertex::Any ();
+  if (v == Vertex::Pass ()) return 0;
+
+  int row = v.GetRow ();
+  int col = v.GetColumn ();
+  Color opponent = Color::OfPlayer (pl.Other ());
+  bool in_eye = IsSurroundedBy (row, col, opponent);
+  grid [row][col] = Color::OfPlayer (pl);
+
+  uint captured = 0;
+  Vertex last_captured = Vertex::Any ();
+  rep (dir, 4) {
+    int nr = row + kDirRow [dir];
+    int nc = col + kDirCol [dir];
+    if (ColorAt (nr, nc) == opponent && LibertiesAt (nr, nc) == 0) {
+      captured += RemoveChain (nr, nc);
+      last_captured = Vertex::OfCoords (nr, nc);
+    }
+  }
+
+  if (in_eye && captured == 1) ko_v = last_captured;
+  return captured;
+}
+
+Hash ReferenceBoard::PositionalHash () const {
+  Hash hash;
+  hash.SetZero ();
+  rep (row, board_size) rep (col, board_size) {
+    if (grid [row][col].IsPlayer ()) {
+      hash ^= ReferenceZobrist ().OfPlayerVertex (grid [row][col].ToPlayer (),
+                                                  Vertex::OfCoords (row, col));
+    }
+  }
+  return hash;
+}
+
+Hash3x3 ReferenceBoard::Hash3x3At (Vertex v) const {
+  int row = v.GetRow ();
+  int col = v.GetColumn ();
+  Hash3x3 hash = Hash3x3::OfRaw (0);
+  bool atari [4];
+  rep (dir, 8) {
+    int nr = row + kDirRow [dir];
+    int nc = col + kDirCol [dir];
+    Color c = ColorAt (nr, nc);
+    hash.SetColorAt (Dir::OfRaw (dir), c);
+    if (dir < 4) atari [dir] = c.IsPlayer () && LibertiesAt (nr, nc) == 1;
+  }
+  hash.SetAtariBits (atari [0], atari [1], atari [2], atari [3]);
+  return hash;
+}
+
+int ReferenceBoard::StoneScore () const {
+  int score = 0;
+  rep (row, board_size) rep (col, board_size) {
+    if (grid [row][col].IsPlayer ()) score += grid [row][col].ToPlayer ().ToScore ();
+  }
+  return score + int (ceil (-komi));
+}
+
+int ReferenceBoard::PlayoutScore () const {
+  int score = StoneScore ();
+  rep (row, board_size) rep (col, board_size) {
+    if (grid [row][col] != Color::Empty ()) continue;
+    if (IsSurroundedBy (row, col, Color::Black ())) score += 1;
+    if (IsSurroundedBy (row, col, Color::White ())) score -= 1;
+  }
+  return score;
+}
+
+int ReferenceBoard::TrompTaylorScore () const {
+  // Stones plus empty points from which only one color is reachable.
+  int score = StoneScore ();
+  bool visited [board_size][board_size] = {};
+  rep (row, board_size) rep (col, board_size) {
+    if (grid [row][col] != Color::Empty () || visited [row][col]) continue;
+    NatMap <Color, bool> reaches (false);
+    uint size = 0;
+    vector <pair <int, int> > stack (1, make_pair (int (row), int (col)));
+    visited [row][col] = true;
+    while (!stack.empty ()) {
+      int r = stack.back ().first;
+      int c = stack.back ().second;
+      stack.pop_back ();
+      size += 1;
+      rep (dir, 4) {
+        int nr = r + kDirRow [dir];
+        int nc = c + kDirCol [dir];
+        Color color = ColorAt (nr, nc);
+        reaches [color] = true;
+        if (color == Color::Empty () && !visited [nr][nc]) {
+          visited [nr][nc] = true;
+          stack.push_back (make_pair (nr, nc));
+        }
+      }
+    }
+    if (reaches [Color::Black ()] && !reaches [Color::White ()]) score += size;
+    if (reaches [Color::White ()] && !reaches [Color::Black ()]) score -= size;
+  }
+  return score;
+}
@@ -0,0 +1,66 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#ifndef REFERENCE_BOARD_H_
+#define REFERENCE_BOARD_H_
+
+#include "hash.hpp"
+
+// Slow and obviously correct board used to test RawBoard.
+// A plain row/column grid, chains and liberties are found by flood fill
+// on every query. Same rules as RawBoard: no suicide, simple ko only
+// (the vertex of a single stone just taken by a stone played into an eye).
+class ReferenceBoard {
+public:
+  ReferenceBoard ();
+
+  void SetKomi (float komi);
+
+  Color ColorAt (Vertex v) const;
+  Player ActPlayer () const;
+  uint MoveCount () const;
+  bool BothPlayerPass () const;
+  Vertex KoVertex () const;
+
+  bool IsLegal (Player pl, Vertex v) const;
+
+  // All 4 neighbours are pl's stones or off board and at most one
+  // diagonal is the opponent's (none on the edge).
+  bool IsEyelike (Player pl, Vertex v) const;
+
+  // Assumes IsLegal (pl, v). Returns the number of captured stones.
+  uint PlayLegal (Player pl, Vertex v);
+
+  // Zobrist hash of the stones, same keys as RawBoard.
+  Hash PositionalHash () const;
+
+  // Neighbour colors and atari bits of an empty vertex.
+  Hash3x3 Hash3x3At (Vertex v) const;
+
+  // Scores as RawBoard defines them, positive is good for black.
+  int StoneScore () const;
+  int PlayoutScore () const;
+  int TrompTaylorScore () const;
+
+private:
+  Color ColorAt (int row, int col) const;
+  bool IsOnBoard (int row, int col) const;
+
+  // Liberties of the chain at (row, col), marks its stones in chain.
+  uint Liberties (int row, int col, bool chain [board_size][board_size]) const;
+  uint LibertiesAt (int row, int col) const;
+  uint RemoveChain (int row, int col);
+
+  // Does every 4-neighbour of (row, col) have color c or is off board?
+  bool IsSurroundedBy (int row, int col, Color c) const;
+
+  Color grid [board_size][board_size];
+  uint move_count;
+  Player last_player;
+  NatMap <Player, Vertex> last_play;
+  Vertex ko_v;
+  float komi;
+};
+
+#endif
@@ -6,7 +6,7 @@
 
 
 struct Sampler {
-  explicit Sampler (const Board& board, const Gammas& gammas) :
+  explicit Sampler (const RawBoard& board, const Gammas& gammas) :
     board (board),
     gammas (gammas)
   {
@@ -300,7 +300,7 @@ public:
   double proximity_bonus [2]; // TODO move this to Gammas 
 
 private:
-  const Board& board;
+  const RawBoard& board;
   const Gammas& gammas;
 
   NatSet <Vertex> is_in_local;
@@ -0,0 +1,129 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#include <cstdlib>
+#include <sstream>
+
+#include "sgf.hpp"
+
+namespace Sgf {
+
+namespace {
+  // Reads property value after '['. Handles escaped characters.
+  bool ReadValue (istream& in, string* value) {
+    value->clear ();
+    char c;
+    while (in.get (c)) {
+      if (c == ']') return true;
+      if (c == '\\' && !in.get (c)) return false;
+      *value += c;
+    }
+    return false;
+  }
+
+  // Adds one point or a compressed "aa:cc" rectangle of points.
+  bool AddStones (Player pl, const string& value, Game* game) {
+    vector <Move>* moves = &game->moves;
+    uint old_size = moves->size ();
+    if (value.size () == 5 && value [2] == ':') {
+      Vertex corner1 = Vertex::OfSgfString (value.substr (0, 2));
+      Vertex corner2 = Vertex::OfSgfString (value.substr (3, 2));
+      if (!corner1.IsOnBoard () || !corner2.IsOnBoard ()) return false;
+      reps (row, corner1.GetRow (), corner2.GetRow () + 1) {
+        reps (col, corner1.GetColumn (), corner2.GetColumn () + 1) {
+          moves->push_back (Move (pl, Vertex::OfCoords (row, col)));
+        }
+      }
+    } else {
+      Vertex v = Vertex::OfSgfString (value);
+      if (!v.IsOnBoard ()) return false;
+      moves->push_back (Move (pl, v));
+    }
+    game->setup_count += moves->size () - old_size;
+    return true;
+  }
+
+  bool AddProperty (const string& name, const string& value, Game* game) {
+    if (name == "B" || name == "W") {
+      Player pl = name == "B" ? Player::Black () : Player::White ();
+      Vertex v = Vertex::OfSgfString (value);
+      if (v == Vertex::Invalid ()) return false;
+      game->moves.push_back (Move (pl, v));
+    } else if (name == "AB") {
+      return AddStones (Player::Black (), value, game);
+    } else if (name == "AW") {
+      return AddStones (Player::White (), value, game);
+    } else if (name == "AE") {
+      return false;
+    } else if (name == "SZ") {
+      game->board_size = atoi (value.c_str ());
+    } else if (name == "KM") {
+      game->komi = atof (value.c_str ());
+    } else if (name == "BR") {
+      game->black_rank = value;
+    } else if (name == "WR") {
+      game->white_rank = value;
+    }
+    return true;
+  }
+}
+
+
+bool ReadGame (istream& in, Game* game) {
+  game->board_size = 0; // no game tree
+  game->komi = 0.0;
+  game->black_rank.clear ();
+  game->white_rank.clear ();
+  game->moves.clear ();
+  game->setup_count = 0;
+
+  char c;
+  while (in >> c && c != '(') {}
+  if (!in) return false;
+  game->board_size = 19; // SGF default
+
+  // After the first variation is closed, the rest of the tree is skipped.
+  uint depth = 1;
+  bool main_line = true;
+  string name;
+  string value;
+
+  while (in >> c) {
+    if (c == '(') {
+      depth += 1;
+    } else if (c == ')') {
+      depth -= 1;
+      main_line = false;
+      if (depth == 0) return true;
+    } else if (c == ';') {
+      name.clear ();
+    } else if (c == '[') {
+      if (!ReadValue (in, &value)) return false;
+      if (main_line && !AddProperty (name, value, game)) return false;
+    } else if (isupper (c)) {
+      // New property name. Lowercase letters (FF[3] style) are ignored.
+      name = c;
+      while (isalpha (in.peek ())) {
+        c = in.get ();
+        if (isupper (c)) name += c;
+      }
+    }
+  }
+  return false;
+}
+
+bool RankOfString (const string& s, int* rank) {
+  istringstream in (s);
+  int number;
+  char kind;
+  if (!(in >> number >> kind) || number < 1) return false;
+  switch (tolower (kind)) {
+  case 'k': *rank = 1 - number; return true;
+  case 'd': *rank = number; return true;
+  case 'p': *rank = 10 + number; return true;
+  default: return false;
+  }
+}
+
+} // namespace Sgf
@@ -0,0 +1,41 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#ifndef SGF_H_
+#define SGF_H_
+
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "move.hpp"
+
+// Streaming SGF reader.
+// Only the main line of a game is read, other variations are skipped.
+namespace Sgf {
+
+  struct Game {
+    uint board_size;
+    float komi;
+    string black_rank; // BR, WR as in the file, "" if missing
+    string white_rank;
+
+    // Setup stones (AB, AW) and moves in the order they appear.
+    vector <Move> moves;
+    uint setup_count; // of moves, from AB and AW
+  };
+
+  // Reads the next game tree from the stream. board_size is 0 if there
+  // was none.
+  // Returns false on end of input, syntax error or unsupported content
+  // (AE, coordinates that don't fit the compiled board_size).
+  bool ReadGame (istream& in, Game* game);
+
+  // Parses ranks like "12k", "3d" or "5p" (anything after the letter is
+  // ignored) to 30k = -29, ..., 1k = 0, 1d = 1, ..., 9d = 9, 1p = 11, ...
+  // Returns false if there is no rank.
+  bool RankOfString (const string& s, int* rank);
+}
+
+#endif
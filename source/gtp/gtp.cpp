@@ -4,6 +4,7 @@
 #include <cassert>
 
 #include "gtp.hpp"
+#include "trace.hpp"
 
 namespace Gtp {
 
@@ -39,7 +40,7 @@ bool Io::IsEmpty() {
   string s;
   std::streampos pos = in.tellg();
   in >> s;
-  bool ok = in;
+  bool ok = bool (in);
   in.seekg(pos);
   in.clear();
   return !ok;
@@ -121,6 +122,7 @@ Repl::Status Repl::RunOneCommand (const string& line, string* report) {
   string command, params;
 
   ParseLine (line, &id, &command, &params);
+  TRACE_SPAN_DETAIL ("GtpCommand", line);
 
   Io io(params);
 
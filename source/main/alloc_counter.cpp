@@ -0,0 +1,66 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "alloc_counter.hpp"
+
+namespace {
+  std::atomic <uint64> alloc_count (0);
+
+  void* CountedAlloc (size_t size) {
+    alloc_count.fetch_add (1, std::memory_order_relaxed);
+    void* ptr = malloc (size == 0 ? 1 : size);
+    if (ptr == NULL) throw std::bad_alloc ();
+    return ptr;
+  }
+}
+
+uint64 AllocCount () {
+  return alloc_count.load (std::memory_order_relaxed);
+}
+
+void* operator new (size_t size) {
+  return CountedAlloc (size);
+}
+
+void* operator new[] (size_t size) {
+  return CountedAlloc (size);
+}
+
+void* operator new (size_t size, const std::nothrow_t&) noexcept {
+  alloc_count.fetch_add (1, std::memory_order_relaxed);
+  return malloc (size == 0 ? 1 : size);
+}
+
+void* operator new[] (size_t size, const std::nothrow_t&) noexcept {
+  alloc_count.fetch_add (1, std::memory_order_relaxed);
+  return malloc (size == 0 ? 1 : size);
+}
+
+void operator delete (void* ptr) noexcept {
+  free (ptr);
+}
+
+void operator delete[] (void* ptr) noexcept {
+  free (ptr);
+}
+
+void operator delete (void* ptr, size_t) noexcept {
+  free (ptr);
+}
+
+void operator delete[] (void* ptr, size_t) noexcept {
+  free (ptr);
+}
+
+void operator delete (void* ptr, const std::nothrow_t&) noexcept {
+  free (ptr);
+}
+
+void operator delete[] (void* ptr, const std::nothrow_t&) noexcept {
+  free (ptr);
+}
@@ -0,0 +1,15 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#ifndef ALLOC_COUNTER_H_
+#define ALLOC_COUNTER_H_
+
+#include "utils.hpp"
+
+// Number of global operator new calls so far, in all threads.
+// Linking alloc_counter.cpp (only alloc_test does) replaces the global
+// operator new and delete with counting versions on top of malloc and free.
+uint64 AllocCount ();
+
+#endif
@@ -0,0 +1,83 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "alloc_counter.hpp"
+#include "engine.hpp"
+#include "benchmark.hpp"
+
+namespace {
+  // Allocations of one genmove with the given playouts from the empty board.
+  uint64 GenmoveAllocs (Engine& engine, uint playouts) {
+    engine.GetParam ().genmove_playouts = playouts;
+    CHECK (engine.Reset (board_size));
+    uint64 allocs_begin = AllocCount ();
+    engine.Genmove (engine.GetBoard ().ActPlayer ());
+    return AllocCount () - allocs_begin;
+  }
+
+  uint64 GenmoveWorkload (const Gammas& gammas, uint n) {
+    Engine engine (gammas);
+    engine.SetQuiet (true);
+    engine.GetParam ().genmove_playouts = 5000;
+    rep (ii, n) {
+      Move m = engine.Genmove (engine.GetBoard ().ActPlayer ());
+      if (!m.IsValid () || engine.GetBoard ().BothPlayerPass ()) {
+        engine.Reset (board_size);
+      }
+    }
+    return 0;
+  }
+
+  // The benchmark suite with heap allocations per unit.
+  int RunBenchmark (uint repeats) {
+    Gammas gammas;
+    Benchmark::Suite suite;
+    suite.Add ("mcts_genmove", "genmoves", 5,
+               bind (GenmoveWorkload, cref (gammas), placeholders::_1));
+    suite.SetAllocCounter (AllocCount);
+    vector <Benchmark::Result> results = suite.Run (max (repeats, 1u));
+    rep (ii, results.size ()) cout << results [ii].ToString () << endl;
+    return 0;
+  }
+}
+
+// Checks that a warm engine does tree playouts without heap allocations,
+// both bare and inside a genmove (whose fixed costs must not grow with
+// the playouts).
+// Usage: alloc_test [playout_count]
+//        alloc_test benchmark [repeats]
+int main (int argc, char** argv) {
+  if (argc > 1 && strcmp (argv[1], "benchmark") == 0) {
+    return RunBenchmark (argc > 2 ? atoi (argv[2]) : 3);
+  }
+  uint playout_cnt = argc > 1 ? atoi (argv[1]) : 2000;
+
+  Gammas gammas;
+  Engine engine (gammas);
+  engine.SetQuiet (true);
+  engine.DoNPlayouts (playout_cnt);
+
+  // A playout expands at most one node.
+  MctsNode::ReserveNodes (2 * playout_cnt * (Board::kArea + 1));
+
+  uint64 allocs_begin = AllocCount ();
+  rep (ii, playout_cnt) engine.DoOnePlayout (true, true);
+  uint64 allocs = AllocCount () - allocs_begin;
+  cout << playout_cnt << " playouts, " << allocs << " allocations" << endl;
+
+  // Warm up, then compare genmoves of n and 2n playouts.
+  GenmoveAllocs (engine, 2 * playout_cnt);
+  uint64 short_allocs = GenmoveAllocs (engine, playout_cnt);
+  uint64 long_allocs = GenmoveAllocs (engine, 2 * playout_cnt);
+  cout << "genmove: " << short_allocs << " allocations with " << playout_cnt
+       << " playouts, " << long_allocs << " with " << 2 * playout_cnt << endl;
+
+  // A once a second stats refresh may fall into one of them.
+  bool genmove_ok = long_allocs <= short_allocs + playout_cnt / 100;
+  return allocs == 0 && genmove_ok ? 0 : 1;
+}
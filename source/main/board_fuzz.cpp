@@ -0,0 +1,17 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#include <cstdlib>
+#include <iostream>
+
+#include "ego.hpp"
+
+// Usage: board_fuzz [game_count] [seed]
+int main (int argc, char** argv) {
+  uint game_count = argc > 1 ? atoi (argv[1]) : 100;
+  uint seed = argc > 2 ? atoi (argv[2]) : 123;
+  bool ok;
+  cout << BoardFuzz::Run (game_count, seed, &ok) << endl;
+  return ok ? 0 : 1;
+}
@@ -2,6 +2,7 @@
 // Copyright 2006 and onwards, Lukasz Lew
 //
 
+#include <fstream>
 #include "gtp_gogui.hpp"
 
 Gtp::ReplWithGogui gtp;
@@ -10,6 +11,10 @@ Gtp::ReplWithGogui gtp;
 #include "engine.hpp"
 //#include "gui.h"
 #include "mcts_gtp.hpp"
+#include "server.hpp"
+#include "batch_analyzer.hpp"
+#include "tactics.hpp"
+#include "selfplay.hpp"
 #include "mm_train.hpp"
 
 
@@ -25,6 +30,94 @@ void GtpBenchmark (Gtp::Io& io) {
   io.out << Benchmark::Run (n);
 }
 
+// Genmoves at fixed playouts in a self-played game, restarted when over.
+uint64 GenmoveWorkload (const Gammas& gammas, uint n) {
+  Engine& engine = *(new Engine (gammas));
+  engine.SetQuiet (true);
+  engine.GetParam ().genmove_playouts = 5000;
+  rep (ii, n) {
+    Move m = engine.Genmove (engine.GetBoard ().ActPlayer ());
+    if (!m.IsValid () || engine.GetBoard ().BothPlayerPass ()) {
+      engine.Reset (board_size);
+    }
+  }
+  delete &engine;
+  return 0;
+}
+
+vector <Benchmark::Result> RunBenchmarkSuite (const Gammas& gammas, uint repeats) {
+  Benchmark::Suite suite;
+  suite.Add ("mcts_genmove", "genmoves", 5,
+             bind (GenmoveWorkload, ref (gammas), placeholders::_1));
+  return suite.Run (repeats);
+}
+
+// Usage: benchmark_suite [repeats] [json_file]
+void GtpBenchmarkSuite (const Gammas& gammas, Gtp::Io& io) {
+  uint repeats = io.Read<uint> (5);
+  string file_name = io.Read<string> ("");
+  io.CheckEmpty ();
+  if (repeats == 0) {
+    io.SetError ("repeats must be positive");
+    return;
+  }
+
+  vector <Benchmark::Result> results = RunBenchmarkSuite (gammas, repeats);
+  rep (ii, results.size ()) io.out << endl << results [ii].ToString ();
+
+  if (file_name != "") {
+    ofstream out (file_name.c_str ());
+    out << Benchmark::ToJson (results);
+    if (!out) io.SetError ("Can't write a file: " + file_name);
+  } else {
+    io.out << endl << Benchmark::ToJson (results);
+  }
+}
+
+// Usage: benchmark_compare baseline_json_file [repeats] [tolerance]
+// Fails when a workload got slower than in the baseline by more than both
+// the tolerance and two standard deviations, or is missing from this run.
+void GtpBenchmarkCompare (const Gammas& gammas, Gtp::Io& io) {
+  string file_name = io.Read<string> ();
+  uint repeats = io.Read<uint> (5);
+  double tolerance = io.Read<double> (0.05);
+  io.CheckEmpty ();
+  if (repeats == 0) {
+    io.SetError ("repeats must be positive");
+    return;
+  }
+
+  ifstream in (file_name.c_str ());
+  vector <Benchmark::Result> baseline;
+  if (!in || !Benchmark::ReadJson (in, &baseline)) {
+    io.SetError ("Can't read baseline: " + file_name);
+    return;
+  }
+
+  vector <Benchmark::Result> results = RunBenchmarkSuite (gammas, repeats);
+  uint regression_count;
+  string report = Benchmark::Compare (baseline, results, tolerance, &regression_count);
+  if (regression_count > 0) {
+    io.SetError (ToString (regression_count) + " regressions\n" + report);
+    return;
+  }
+  io.out << endl << report;
+}
+
+// Usage: benchmark_threads [max_threads] [playouts_per_thread]
+void GtpBenchmarkThreads (Gtp::Io& io) {
+  uint max_thread_cnt = io.Read<uint> (0);
+  uint playout_cnt = io.Read<uint> (20000);
+  io.CheckEmpty ();
+  io.out << Benchmark::RunThreads (max_thread_cnt, playout_cnt);
+}
+
+void GtpMicrobenchmark (Gtp::Io& io) {
+  uint n = io.Read<uint> (10000);
+  io.CheckEmpty ();
+  io.out << Microbenchmark::Run (n);
+}
+
 void GtpBoardTest (Gtp::Io& io) {
   bool print_moves = io.Read<bool> (false);
   io.CheckEmpty ();
@@ -37,9 +130,130 @@ void GtpSamplerTest (Gtp::Io& io) {
   SamplerPlayoutTest (print_moves);
 }
 
+// Usage: board_fuzz [game_count] [seed]
+void GtpBoardFuzz (Gtp::Io& io) {
+  uint game_count = io.Read<uint> (100);
+  uint seed = io.Read<uint> (123);
+  io.CheckEmpty ();
+  bool ok;
+  string report = BoardFuzz::Run (game_count, seed, &ok);
+  if (ok) {
+    io.out << report;
+  } else {
+    io.SetError (report);
+  }
+}
+
+// Usage: perft [depth] [position_count] [check_reference]
+void GtpPerft (Gtp::Io& io) {
+  uint depth = io.Read<uint> (3);
+  uint position_count = io.Read<uint> (6);
+  bool check_reference = io.Read<bool> (false);
+  io.CheckEmpty ();
+  bool ok;
+  string report = Perft::Run (depth, position_count, check_reference, &ok);
+  if (ok) {
+    io.out << report;
+  } else {
+    io.SetError (report);
+  }
+}
+
+// Usage: mm_test [thread_count] [sgd]
 void GtpMmTest (Gtp::Io& io) {
+  uint thread_count = io.Read<uint> (1);
+  bool sgd = io.Read<bool> (false);
+  io.CheckEmpty ();
+  Mm::Test (max (thread_count, 1u), sgd);
+}
+
+// Usage: log_level [error|warning|info|debug]
+void GtpLogLevel (Gtp::Io& io) {
+  if (io.IsEmpty ()) {
+    io.out << Log::LevelToString (Log::GetLevel ());
+    return;
+  }
+  string name = io.Read<string> ();
+  io.CheckEmpty ();
+  Log::Level level;
+  if (!Log::LevelOfString (name, &level)) {
+    io.SetError ("unknown log level: " + name);
+    return;
+  }
+  Log::SetLevel (level);
+}
+
+// Usage: trace on|off|clear
+void GtpTrace (Gtp::Io& io) {
+  string action = io.Read<string> ();
+  io.CheckEmpty ();
+  if (action == "on") {
+    Trace::Enable (true);
+  } else if (action == "off") {
+    Trace::Enable (false);
+  } else if (action == "clear") {
+    Trace::Clear ();
+  } else {
+    io.SetError ("expected on, off or clear");
+  }
+}
+
+// Usage: trace_write file_name
+// Writes recorded spans in Chrome trace-event format.
+void GtpTraceWrite (Gtp::Io& io) {
+  string file_name = io.Read<string> ();
+  io.CheckEmpty ();
+  ofstream out (file_name.c_str ());
+  Trace::WriteJson (out);
+  if (!out) io.SetError ("Can't write a file: " + file_name);
+}
+
+// Text or binary gamma file, see gammas.hpp.
+void GtpLoadGammas (Gammas& gammas, Gtp::Io& io) {
+  string file_name = io.Read<string> ();
+  io.CheckEmpty ();
+  string error;
+  if (!gammas.Load (file_name, &error)) {
+    io.SetError (error);
+    return;
+  }
+}
+
+// Usage: gammas_convert in_file binary_file
+void GtpGammasConvert (Gtp::Io& io) {
+  string in_file_name = io.Read<string> ();
+  string out_file_name = io.Read<string> ();
   io.CheckEmpty ();
-  Mm::Test ();
+  Gammas gammas;
+  string error;
+  if (!gammas.Load (in_file_name, &error)) {
+    io.SetError (error);
+    return;
+  }
+  if (!gammas.WriteBinary (out_file_name)) {
+    io.SetError ("Can't write a file: " + out_file_name);
+    return;
+  }
+}
+
+// Usage: mm_predict corpus_file [top_k] [max_games]
+// Ranks moves of held-out games by the loaded gammas.
+void GtpMmPredict (const Gammas& gammas, Gtp::Io& io) {
+  string file_name = io.Read<string> ();
+  uint top_k = io.Read<uint> (5);
+  uint max_games = io.Read<uint> (0);
+  io.CheckEmpty ();
+  if (top_k == 0) {
+    io.SetError ("top_k must be positive");
+    return;
+  }
+  GameCorpus::Reader corpus;
+  string error;
+  if (!corpus.Open (file_name, &error)) {
+    io.SetError (error);
+    return;
+  }
+  io.out << MovePrediction::Run (corpus, gammas, top_k, max_games).ToString ();
 }
 
 int main(int argc, char** argv) {
@@ -52,12 +266,34 @@ int main(int argc, char** argv) {
   gtp.RegisterStatic("version", STRING(VERSION));
   gtp.RegisterStatic("protocol_version", "2");
   gtp.Register ("benchmark", GtpBenchmark);
+  gtp.Register ("benchmark_threads", GtpBenchmarkThreads);
+  gtp.Register ("microbenchmark", GtpMicrobenchmark);
   gtp.Register ("board_test", GtpBoardTest);
   gtp.Register ("sampler_test", GtpSamplerTest);
+  gtp.Register ("board_fuzz", GtpBoardFuzz);
+  gtp.Register ("perft", GtpPerft);
   gtp.Register ("mm_test", GtpMmTest);
+  gtp.Register ("log_level", GtpLogLevel);
+  gtp.Register ("trace", GtpTrace);
+  gtp.Register ("trace_write", GtpTraceWrite);
+
+  // Shared by the engine and all server sessions.
+  Gammas& gammas = *(new Gammas());
+  gtp.Register ("LoadGammas", bind (GtpLoadGammas, ref (gammas), placeholders::_1));
+  gtp.Register ("gammas_convert", GtpGammasConvert);
+  gtp.Register ("benchmark_suite",
+                bind (GtpBenchmarkSuite, cref (gammas), placeholders::_1));
+  gtp.Register ("mm_predict",
+                bind (GtpMmPredict, cref (gammas), placeholders::_1));
+  gtp.Register ("benchmark_compare",
+                bind (GtpBenchmarkCompare, cref (gammas), placeholders::_1));
 
-  Engine& engine = *(new Engine());
-  MctsGtp mcts_gtp (engine);
+  Engine& engine = *(new Engine(gammas));
+  MctsGtp mcts_gtp (gtp, engine);
+  Server server (gtp, gammas);
+  BatchAnalyzer batch_analyzer (gtp, gammas, engine);
+  Tactics tactics (gtp, gammas, engine);
+  SelfPlay selfplay (gtp, gammas, engine);
 
   reps (ii, 1, argc) {
     if (ii == argc-1 && string (argv[ii]) == "gtp") continue;
@@ -82,6 +318,7 @@ int main(int argc, char** argv) {
   }
 
   delete &engine;
+  delete &gammas;
 
   return 0;
 }
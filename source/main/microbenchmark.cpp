@@ -0,0 +1,15 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#include <cstdlib>
+#include <iostream>
+
+#include "ego.hpp"
+
+// Usage: microbenchmark [position_count]
+int main (int argc, char** argv) {
+  uint position_count = argc > 1 ? atoi (argv[1]) : 10000;
+  cout << Microbenchmark::Run (position_count);
+  return 0;
+}
@@ -1,132 +1,224 @@
 #include <algorithm>
-#include "all_hash3x3.hpp"
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <thread>
 #include "mm.hpp"
 
 struct MmTrain {
-  MmTrain () :
-    random(123),
-    pattern_level (uint(-1))
-  {
+  MmTrain () {
+    gtp.Register ("mm_convert", this, &MmTrain::GtpMmConvert);
+    gtp.Register ("mm_convert_sgf", this, &MmTrain::GtpMmConvertSgf);
     gtp.Register ("mm_train", this, &MmTrain::GtpMmTrain);
+    gtp.Register ("mm_train_sgd", this, &MmTrain::GtpMmTrainSgd);
   }
 
+  // Usage: mm_convert text_file corpus_file
+  void GtpMmConvert (Gtp::Io& io) {
+    string in_file_name = io.Read <string> ();
+    string out_file_name = io.Read <string> ();
+    io.CheckEmpty();
+
+    ifstream in (in_file_name.c_str ());
+    if (!in.good ()) {
+      io.SetError ("Can't open in-file: " + in_file_name);
+      return;
+    }
+    uint64 game_count;
+    string error;
+    if (!GameCorpus::ConvertText (in, out_file_name, &game_count, &error)) {
+      io.SetError (error);
+      return;
+    }
+    io.out << game_count << " games";
+  }
+
+  // Usage: mm_convert_sgf sgf_dir corpus_file [threads] [min_rank]
+  void GtpMmConvertSgf (Gtp::Io& io) {
+    string dir_name = io.Read <string> ();
+    string out_file_name = io.Read <string> ();
+    uint   thread_count = io.Read <uint> (0);
+    string min_rank = io.Read <string> ("");
+    io.CheckEmpty();
+
+    if (thread_count == 0) thread_count = max (thread::hardware_concurrency (), 1u);
+
+    GameCorpus::SgfStats stats;
+    string error;
+    if (!GameCorpus::ConvertSgf (dir_name, out_file_name, min_rank, thread_count,
+                                 &stats, &error)) {
+      io.SetError (error);
+      return;
+    }
+    io.out << stats.ToString ();
+  }
+
+  // Usage: mm_train corpus_file out_file needed_moves epochs [threads]
   void GtpMmTrain (Gtp::Io& io) {
     string file_name = io.Read <string> ();
     string out_file_name = io.Read <string> ();
     uint   needed_moves = io.Read <uint> ();
     uint   epochs = io.Read <uint> ();
+    uint   thread_count = io.Read <uint> (0);
     io.CheckEmpty();
 
-    ifstream file;
     ofstream out_file;
+    if (!Prepare (io, file_name, out_file_name, needed_moves, thread_count, &out_file)) {
+      return;
+    }
+    cerr << "Learning..." << endl << flush;
+    Learn (epochs);
+    cerr << "Dumping..." << endl << flush;
+    Dump (out_file);
+    cerr << "Done." << endl << flush;
+    out_file.close ();
+  }
+
+  // Usage: mm_train_sgd corpus_file out_file needed_moves max_epochs
+  //          [threads] [batch_size] [learning_rate] [validation_fraction]
+  void GtpMmTrainSgd (Gtp::Io& io) {
+    string file_name = io.Read <string> ();
+    string out_file_name = io.Read <string> ();
+    uint   needed_moves = io.Read <uint> ();
+    uint   max_epochs = io.Read <uint> ();
+    uint   thread_count = io.Read <uint> (0);
+    uint   batch_size = io.Read <uint> (1024);
+    double learning_rate = io.Read <double> (0.5);
+    double validation_fraction = io.Read <double> (0.1);
+    io.CheckEmpty();
 
-    file.open (file_name.c_str(), ifstream::in);
-    if (!file.good()) {
-      io.SetError ("Can't open in-file: " + file_name);
+    if (batch_size == 0 || learning_rate <= 0.0 ||
+        validation_fraction <= 0.0 || validation_fraction >= 1.0)
+    {
+      io.SetError ("bad batch_size, learning_rate or validation_fraction");
       return;
     }
 
-    out_file.open (out_file_name.c_str(), ofstream::out);
-    if (!out_file.good()) {
-      io.SetError ("Can't open out-file: " + out_file_name);
+    ofstream out_file;
+    if (!Prepare (io, file_name, out_file_name, needed_moves, thread_count, &out_file)) {
+      return;
+    }
+    model.HoldOut (validation_fraction);
+    WW (model.matches.MatchCount ());
+    WW (model.validation.MatchCount ());
+    if (model.validation.MatchCount () == 0 || model.matches.MatchCount () == 0) {
+      io.SetError ("too few matches for a validation split");
       return;
     }
-    
-    cerr << "Initializing..." << endl << flush;
-    Init ();
-    cerr << "Reading game file..." << endl << flush;
-    Read (file, needed_moves);
-    file.close ();
-    cerr << "Harvesting pattern data..." << endl << flush;
-    Harvest();
     cerr << "Learning..." << endl << flush;
-    Learn (epochs);
+    model.PreprocessData ();
+    model.TrainSgd (max_epochs, batch_size, learning_rate);
     cerr << "Dumping..." << endl << flush;
     Dump (out_file);
     cerr << "Done." << endl << flush;
     out_file.close ();
   }
 
-  void Read (istream& in, double needed_move_count) {
-    uint game_no = 0;
-    uint total_move_count = 0;
-
-    string s;
-    while (in >> s) {
-      CHECK (s == "file");
-      games.resize (game_no + 1);
-      files.resize (game_no + 1);
-
-      getline (in, files[game_no]);
-      CHECK (in);
-
-      uint bs;
-      CHECK (in >> bs);
-      
-      uint move_count;
-      CHECK (in >> move_count);
-      total_move_count += move_count;
-
-      games [game_no].resize (move_count);
-      rep (ii, move_count) {
-        Move m = Move::OfGtpStream (in);
-        CHECK (m.IsValid ());
-        games [game_no] [ii] = m;
-      }
-      if (bs == board_size) {
-        game_no += 1;
-      }
+  // Opens the files and harvests matches. Sets an error on failure.
+  bool Prepare (Gtp::Io& io, const string& file_name, const string& out_file_name,
+                uint needed_moves, uint thread_count, ofstream* out_file) {
+    if (thread_count == 0) thread_count = max (thread::hardware_concurrency (), 1u);
+
+    string error;
+    if (!corpus.Open (file_name, &error)) {
+      io.SetError (error + " (text games can be converted with mm_convert)");
+      return false;
+    }
+    if (corpus.GameCount () == 0 || corpus.TotalMoveCount () == 0) {
+      corpus.Close ();
+      io.SetError ("empty corpus: " + file_name);
+      return false;
     }
 
-    accept_prob = needed_move_count / total_move_count;
+    out_file->open (out_file_name.c_str(), ofstream::out);
+    if (!out_file->good()) {
+      io.SetError ("Can't open out-file: " + out_file_name);
+      return false;
+    }
+    
+    accept_prob = double (needed_moves) / corpus.TotalMoveCount ();
     WW (accept_prob);
+    cerr << "Harvesting pattern data..." << endl << flush;
+    model = Mm::BtModel ();
+    model.thread_count = thread_count;
+    Harvest (thread_count);
+    corpus.Close ();
+    return true;
   }
 
-  void Init () {
-    All2051Hash3x3 all2051;
-    level_to_pattern.resize (2051);
-    all2051.Generate (5000);
-    CHECK (all2051.unique.size() == 2051);
-    rep (level, 2051) {
-      Hash3x3 all[8];
-      all2051.unique [level].GetAll8Symmetries (all);
-      rep (ii, 8) {
-        pattern_level [all [ii]] = level;
-      }
-      level_to_pattern [level] = all [0];
+  // Games are split into contiguous shards, one per thread. Each game
+  // samples moves with its own seed and shards are merged in order, so
+  // the matches don't depend on the number of threads.
+  void Harvest (uint thread_count) {
+    uint game_count = corpus.GameCount ();
+    thread_count = max (1u, min (thread_count, game_count));
+    vector <Mm::MatchSet> shard_matches (thread_count);
+    atomic <uint> done_count (0);
+
+    vector <thread> threads;
+    rep (ii, thread_count) {
+      uint begin = uint64 (game_count) * ii / thread_count;
+      uint end   = uint64 (game_count) * (ii + 1) / thread_count;
+      threads.push_back (thread (&MmTrain::HarvestShard, this, begin, end,
+                                 &shard_matches [ii], &done_count));
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+    chrono::steady_clock::time_point report = start;
+    while (done_count.load () < game_count) {
+      this_thread::sleep_for (chrono::milliseconds (100));
+      if (chrono::steady_clock::now () - report < chrono::seconds (1)) continue;
+      report = chrono::steady_clock::now ();
+      LOG (Log::Info, "harvest: " << done_count.load () << "/" << game_count
+           << " games, " << done_count.load () / SecondsSince (start) << " games/s");
+    }
+    rep (ii, threads.size ()) threads [ii].join ();
+    LOG (Log::Info, "harvest: " << game_count << " games on " << thread_count
+         << " threads, " << game_count / SecondsSince (start) << " games/s");
+
+    rep (ii, shard_matches.size ()) {
+      model.matches.Append (shard_matches [ii]);
     }
   }
 
-  void Harvest () {
-    rep (game_no, games.size()) {
-      if (game_no % (games.size() / 50) == 0) {
-        cerr << "." << flush;
-      }
-      const vector<Move> & moves = games[game_no];
+  static double SecondsSince (chrono::steady_clock::time_point time) {
+    return chrono::duration <double> (chrono::steady_clock::now () - time).count ();
+  }
+
+  void HarvestShard (uint begin, uint end, Mm::MatchSet* matches,
+                     atomic <uint>* done_count) {
+    Board board;
+    for (uint game_no = begin; game_no < end; game_no++) {
+      FastRandom random (game_no * 2654435761u % 2147483646u + 1);
       board.Clear ();
-      
-      rep (move_no, moves.size()) {
-        Move m = moves [move_no];
-        HarvestNewMatch (m);
+
+      rep (move_no, corpus.MoveCount (game_no)) {
+        Move m = corpus.GetMove (game_no, move_no);
+        HarvestNewMatch (board, m, random, matches);
         CHECK2 (board.IsLegal (m), {
           cerr
             << "Illegal move " << m.ToGtpString()
             << " nr " << move_no
-            << " in file " << files[game_no]
+            << " in game " << game_no
             << endl;
         });
         board.PlayLegal (m);
       }
+      done_count->fetch_add (1);
     }
-    cerr << endl;
   }
 
-  void HarvestNewMatch (Move m) {
+  void HarvestNewMatch (const Board& board, Move m, FastRandom& random,
+                        Mm::MatchSet* matches) {
     if (random.NextDouble () > accept_prob) return;
+    // Pass has no pattern, the match would have no winner.
+    if (m.GetVertex () == Vertex::Pass ()) return;
+    // Out of turn, e.g. setup stones in an older corpus: nobody chose it.
+    if (m.GetPlayer () != board.ActPlayer ()) return;
 
     Player pl = m.GetPlayer ();
 
-    Mm::Match& match = model.NewMatch();
+    matches->NewMatch ();
 
     rep (ii, board.EmptyVertexCount()) {
       Vertex v = board.EmptyVertex (ii);
@@ -138,49 +230,46 @@ struct MmTrain {
         hash = hash.InvertColors();
       }
 
-      CHECK (pattern_level [hash] != uint(-1));
+      uint level = Hash3x3Table::Get ().Index (hash);
+      CHECK (level != Hash3x3Table::kNoIndex);
 
-      Mm::Team& team = match.NewTeam();
-      team.SetFeatureLevel (Mm::kPatternFeature, pattern_level [hash]);
+      matches->NewTeam ();
+      matches->SetFeatureLevel (Mm::kPatternFeature, level);
 
       if (v == m.GetVertex()) {
-        match.SetWinnerLastTeam();
+        matches->SetWinnerLastTeam ();
       }
     }
   }
 
   void Learn (uint epochs) {
-    WW(model.matches.size());
+    WW(model.matches.MatchCount ());
 
     model.PreprocessData ();
     model.Train (epochs);
   }
 
   void Dump (ostream& out) {
-    vector <pair <double, uint> > sort_tab (2051);
-    rep (level, 2051) {
+    const uint level_count = Hash3x3Table::kCanonicalCount;
+    vector <pair <double, uint> > sort_tab (level_count);
+    rep (level, level_count) {
       sort_tab [level].first  = model.gammas.Get (Mm::kPatternFeature, level);
       sort_tab [level].second = level;
     }
     std::sort (sort_tab.begin(), sort_tab.end());
-    rep (level, 2051) {
+    rep (level, level_count) {
       out 
-        << setw(7) << level_to_pattern [sort_tab [level].second].GetRaw()  << ", "
+        << setw(7)
+        << Hash3x3Table::Get ().Canonical (sort_tab [level].second).GetRaw() << ", "
         << sort_tab [level].first
         << endl;
     }
   }
 
-  vector <vector <Move> > games;
-  vector <string> files;
+  GameCorpus::Reader corpus;
   double accept_prob;
 
-  Board board;
-  FastRandom random;
   Mm::BtModel model;
-
-  NatMap <Hash3x3, uint> pattern_level;
-  vector <Hash3x3> level_to_pattern;
 };
 
 MmTrain mm_train;
@@ -8,6 +8,7 @@
 #include <vector>
 
 #include "utils.hpp"
+#include "test.hpp"
 #include "fast_random.hpp"
 
 template <typename Elt, uint max_size> class FastStack {
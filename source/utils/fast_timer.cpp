@@ -51,6 +51,7 @@ uint64 FastTimer::GetCcTime () {
 void FastTimer::Reset () {
   sample_cnt = 0;
   sample_sum = 0;
+  last_sample = 0;
 }
 
 
@@ -62,8 +63,9 @@ void FastTimer::Start () {
 void FastTimer::Stop () {
   uint64 stop_time;
   stop_time = GetCcTime ();
+  last_sample = double (stop_time - start_time) - overhead;
   sample_cnt += 1.0;
-  sample_sum += double (stop_time - start_time) - overhead;
+  sample_sum += last_sample;
 }
 
 
@@ -72,6 +74,11 @@ double FastTimer::Ticks () {
 }
 
 
+double FastTimer::LastTicks () {
+  return last_sample;
+}
+
+
 string FastTimer::ToString (float unit) {
   ostringstream s;
   s.precision(15);
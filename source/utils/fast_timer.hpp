@@ -14,6 +14,7 @@ public:
   void Start();
   void Stop();
   double Ticks();
+  double LastTicks ();  // of the last Start/Stop pair
   std::string ToString (float unit = 1.0);
 
 public:
@@ -21,6 +22,7 @@ public:
 
   double  sample_cnt;
   double  sample_sum;
+  double  last_sample;
   uint64  start_time;
   double  overhead;
 };
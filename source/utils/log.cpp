@@ -0,0 +1,207 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+#include "log.hpp"
+#include "trace.hpp"
+#include "to_string.hpp"
+
+namespace Log {
+
+namespace {
+
+// Bounded multi-producer queue (D. Vyukov) with a single consumer.
+// A slot is free for the producer when its sequence equals the position,
+// and full for the consumer when it equals the position + 1.
+// The drain thread sleeps on a condition variable; producers take the
+// mutex only to wake it, when it is sleeping.
+class Logger {
+public:
+  Logger ()
+    : enqueue_pos (0), dequeue_pos (0), written (0), dropped (0),
+      sleeping (false), stopping (false)
+  {
+    rep (ii, kCapacity) slots [ii].sequence.store (ii, memory_order_relaxed);
+    drain_thread = thread (&Logger::DrainLoop, this);
+  }
+
+  ~Logger () {
+    stopping.store (true);
+    Wake ();
+    drain_thread.join ();
+  }
+
+  void Push (string& message) {
+    uint64 pos = enqueue_pos.load (memory_order_relaxed);
+    while (true) {
+      Slot& slot = slots [pos & (kCapacity - 1)];
+      uint64 seq = slot.sequence.load (memory_order_acquire);
+      if (seq == pos) {
+        if (enqueue_pos.compare_exchange_weak (pos, pos + 1, memory_order_relaxed)) {
+          slot.text.swap (message);
+          slot.sequence.store (pos + 1, memory_order_release);
+          Wake ();
+          return;
+        }
+      } else if (seq < pos) {
+        dropped.fetch_add (1, memory_order_relaxed);
+        Wake ();
+        return;
+      } else {
+        pos = enqueue_pos.load (memory_order_relaxed);
+      }
+    }
+  }
+
+  void Flush () {
+    uint64 target = enqueue_pos.load ();
+    unique_lock <mutex> lock (wake_mutex);
+    while (written.load () < target) flushed.wait (lock);
+  }
+
+private:
+  static const uint kCapacity = 1 << 12; // has to be a power of two
+
+  struct Slot {
+    atomic <uint64> sequence;
+    string text;
+  };
+
+  // Pairs with the fence in DrainLoop: either the drain thread sees the
+  // new message or we see it sleeping.
+  void Wake () {
+    atomic_thread_fence (memory_order_seq_cst);
+    if (!sleeping.load (memory_order_relaxed)) return;
+    lock_guard <mutex> lock (wake_mutex);
+    work_ready.notify_one ();
+  }
+
+  bool HasWork () {
+    Slot& slot = slots [dequeue_pos & (kCapacity - 1)];
+    return slot.sequence.load (memory_order_acquire) == dequeue_pos + 1 ||
+      dropped.load () > 0;
+  }
+
+  // Appends all complete messages to batch.
+  void PopAll (string* batch) {
+    while (true) {
+      Slot& slot = slots [dequeue_pos & (kCapacity - 1)];
+      if (slot.sequence.load (memory_order_acquire) != dequeue_pos + 1) return;
+      *batch += slot.text;
+      if (slot.text.size () == 0 || slot.text [slot.text.size () - 1] != '\n') {
+        *batch += '\n';
+      }
+      slot.text.clear ();
+      slot.sequence.store (dequeue_pos + kCapacity, memory_order_release);
+      dequeue_pos += 1;
+    }
+  }
+
+  void DrainLoop () {
+    string batch;
+    while (true) {
+      bool stop = stopping.load ();
+      batch.clear ();
+      PopAll (&batch);
+
+      uint drop_count = dropped.exchange (0);
+      if (drop_count > 0) {
+        batch += "log: " + ToString (drop_count) + " messages dropped\n";
+      }
+
+      if (batch.size () > 0) {
+        TRACE_SPAN ("LogWrite");
+        fwrite (batch.data (), 1, batch.size (), stderr);
+        fflush (stderr);
+      }
+      written.store (dequeue_pos);
+      {
+        lock_guard <mutex> lock (wake_mutex);
+        flushed.notify_all ();
+      }
+
+      if (batch.size () == 0) {
+        if (stop) return;
+        unique_lock <mutex> lock (wake_mutex);
+        sleeping.store (true, memory_order_relaxed);
+        atomic_thread_fence (memory_order_seq_cst);
+        while (!HasWork () && !stopping.load ()) work_ready.wait (lock);
+        sleeping.store (false, memory_order_relaxed);
+      }
+    }
+  }
+
+  Slot slots [kCapacity];
+  atomic <uint64> enqueue_pos;
+  uint64 dequeue_pos;          // used only by the drain thread
+  atomic <uint64> written;
+  atomic <uint> dropped;
+  atomic <bool> sleeping;
+  atomic <bool> stopping;
+  mutex wake_mutex;
+  condition_variable work_ready;
+  condition_variable flushed;  // written moved
+  thread drain_thread;
+};
+
+atomic <int> current_level (Info);
+
+Logger& TheLogger () {
+  static Logger logger;
+  return logger;
+}
+
+} // namespace
+
+
+void SetLevel (Level level) {
+  current_level.store (level, memory_order_relaxed);
+}
+
+
+Level GetLevel () {
+  return Level (current_level.load (memory_order_relaxed));
+}
+
+
+bool IsEnabled (Level level) {
+  return level <= current_level.load (memory_order_relaxed);
+}
+
+
+const char* const level_names [] = { "error", "warning", "info", "debug" };
+
+
+bool LevelOfString (const string& name, Level* level) {
+  rep (ii, 4) {
+    if (name == level_names [ii]) {
+      *level = Level (ii);
+      return true;
+    }
+  }
+  return false;
+}
+
+
+string LevelToString (Level level) {
+  return level_names [level];
+}
+
+
+void Write (Level level, string& message) {
+  if (level <= Warning) message = LevelToString (level) + ": " + message;
+  TheLogger ().Push (message);
+}
+
+
+void Flush () {
+  TheLogger ().Flush ();
+}
+
+} // namespace Log
@@ -0,0 +1,49 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#ifndef LOG_H_
+#define LOG_H_
+
+#include <sstream>
+#include <string>
+
+#include "utils.hpp"
+
+// Levelled logging to stderr.
+// Messages go to a lock-free ring buffer and are written by a background
+// thread, so logging threads never wait for stderr. When the buffer is
+// full messages are dropped and the drop is reported. The level is Info
+// unless set.
+namespace Log {
+
+  enum Level { Error, Warning, Info, Debug };
+
+  void SetLevel (Level level);
+  Level GetLevel ();
+  bool IsEnabled (Level level);
+
+  // Returns false on unknown name.
+  bool LevelOfString (const string& name, Level* level);
+  string LevelToString (Level level);
+
+  // Use LOG macro instead.
+  void Write (Level level, string& message);
+
+  // Waits until all messages written so far reach stderr.
+  void Flush ();
+}
+
+// Usage: LOG (Log::Debug, "text " << value << ...);
+// The message is not built when the level is disabled.
+#define LOG(level, message)                                     \
+  do {                                                          \
+    if (Log::IsEnabled (level)) {                               \
+      ostringstream log_stream__;                               \
+      log_stream__ << message;                                  \
+      string log_message__ = log_stream__.str ();               \
+      Log::Write (level, log_message__);                        \
+    }                                                           \
+  } while (false)
+
+#endif
@@ -7,6 +7,7 @@
 
 #include "test.hpp"
 #include <cmath>
+#include <cstring>
 #include <iostream>
 
 
@@ -0,0 +1,164 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "perf_counters.hpp"
+
+namespace {
+#ifdef __linux__
+  int OpenCounter (uint type, uint64 config) {
+    perf_event_attr attr;
+    memset (&attr, 0, sizeof (attr));
+    attr.size = sizeof (attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // Counters are multiplexed when there are more than the hardware has.
+    attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // this thread, any cpu
+    return syscall (__NR_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+
+  uint64 CacheMisses (uint64 cache) {
+    return cache |
+      (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  }
+#endif
+}
+
+
+PerfCounters::PerfCounters () {
+  rep (ii, kCount) fd [ii] = -1;
+#ifdef __linux__
+  fd [Instructions] = OpenCounter (PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+  fd [Cycles]       = OpenCounter (PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+  fd [L1dMisses]    = OpenCounter (PERF_TYPE_HW_CACHE, CacheMisses (PERF_COUNT_HW_CACHE_L1D));
+  fd [LlcMisses]    = OpenCounter (PERF_TYPE_HW_CACHE, CacheMisses (PERF_COUNT_HW_CACHE_LL));
+  fd [BranchMisses] = OpenCounter (PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+#endif
+  Reset ();
+}
+
+
+PerfCounters::~PerfCounters () {
+#ifdef __linux__
+  rep (ii, kCount) if (fd [ii] >= 0) close (fd [ii]);
+#endif
+}
+
+
+bool PerfCounters::IsAvailable () const {
+  rep (ii, kCount) if (fd [ii] >= 0) return true;
+  return false;
+}
+
+
+bool PerfCounters::Has (Counter counter) const {
+  return fd [counter] >= 0;
+}
+
+
+void PerfCounters::Reset () {
+  rep (ii, kCount) {
+    start [ii] = Sample ();
+    sum [ii] = 0;
+  }
+}
+
+
+void PerfCounters::Start () {
+  rep (ii, kCount) start [ii] = Read (Counter (ii));
+}
+
+
+// Scaled up by enabled / running time when the counter was multiplexed.
+void PerfCounters::Stop () {
+  rep (ii, kCount) {
+    Sample end = Read (Counter (ii));
+    uint64 value = end.value - start [ii].value;
+    uint64 enabled = end.enabled - start [ii].enabled;
+    uint64 running = end.running - start [ii].running;
+    if (running > 0 && running < enabled) {
+      value = uint64 (double (value) * enabled / running);
+    }
+    sum [ii] += value;
+  }
+}
+
+
+uint64 PerfCounters::Get (Counter counter) const {
+  return sum [counter];
+}
+
+
+PerfCounters::Sample PerfCounters::Read (Counter counter) const {
+  Sample sample;
+#ifdef __linux__
+  // Layout given by read_format.
+  uint64 data [3];
+  if (fd [counter] >= 0 && read (fd [counter], data, sizeof (data)) == sizeof (data)) {
+    sample.value = data [0];
+    sample.enabled = data [1];
+    sample.running = data [2];
+  }
+#else
+  unused (counter);
+#endif
+  return sample;
+}
+
+
+const char* PerfCounters::Name (Counter counter) {
+  switch (counter) {
+  case Instructions: return "instructions";
+  case Cycles:       return "cycles";
+  case L1dMisses:    return "L1d misses";
+  case LlcMisses:    return "LLC misses";
+  case BranchMisses: return "branch misses";
+  case kCount:       break;
+  }
+  return "?";
+}
+
+
+const char* PerfCounters::Key (Counter counter) {
+  switch (counter) {
+  case Instructions: return "instructions";
+  case Cycles:       return "cycles";
+  case L1dMisses:    return "l1d_misses";
+  case LlcMisses:    return "llc_misses";
+  case BranchMisses: return "branch_misses";
+  case kCount:       break;
+  }
+  return "unknown";
+}
+
+
+string PerfCounters::ToString (double divisor, const string& unit) const {
+  ostringstream out;
+  rep (ii, kCount) {
+    if (!Has (Counter (ii))) continue;
+    out << "  " << setw (14) << left << Name (Counter (ii)) << right
+        << fixed << setprecision (2) << setw (12)
+        << double (sum [ii]) / divisor << " per " << unit << endl;
+  }
+  if (Has (Instructions) && Has (Cycles) && sum [Cycles] > 0) {
+    out << "  " << setw (14) << left << "IPC" << right
+        << setw (12) << double (sum [Instructions]) / sum [Cycles] << endl;
+  }
+  return out.str ();
+}
@@ -0,0 +1,60 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#ifndef PERF_COUNTERS_H_
+#define PERF_COUNTERS_H_
+
+#include <string>
+
+#include "utils.hpp"
+
+// Hardware performance counters of the calling thread (perf_event_open on
+// Linux). Counters that can't be opened (other systems, no permission,
+// virtual machines) are simply missing; FastTimer cycles still work.
+class PerfCounters {
+public:
+  enum Counter {
+    Instructions,
+    Cycles,
+    L1dMisses,
+    LlcMisses,
+    BranchMisses,
+    kCount
+  };
+
+  PerfCounters ();
+  ~PerfCounters ();
+
+  bool IsAvailable () const;
+  bool Has (Counter counter) const;
+
+  void Reset ();
+  void Start ();
+  void Stop ();   // adds the events since Start
+
+  uint64 Get (Counter counter) const;
+  static const char* Name (Counter counter);
+  static const char* Key (Counter counter);  // for JSON fields
+
+  // Available counters divided by divisor, one per line:
+  // "  instructions 1234.5 per move", and IPC. Empty if none is available.
+  std::string ToString (double divisor, const std::string& unit) const;
+
+private:
+  // Count and times the counter was enabled and running, in ns.
+  struct Sample {
+    Sample () : value (0), enabled (0), running (0) {}
+    uint64 value;
+    uint64 enabled;
+    uint64 running;
+  };
+
+  Sample Read (Counter counter) const;
+
+  int fd [kCount];
+  Sample start [kCount];
+  uint64 sum [kCount];
+};
+
+#endif
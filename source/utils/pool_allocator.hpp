@@ -0,0 +1,208 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#ifndef POOL_ALLOCATOR_H_
+#define POOL_ALLOCATOR_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "utils.hpp"
+
+// Bytes all block pools of the process took from the system.
+inline std::atomic <size_t>& BlockPoolBytes () {
+  static std::atomic <size_t> bytes (0);
+  return bytes;
+}
+
+
+// Free lists of equally sized blocks. Every thread allocates from and
+// frees to its own list without locking; lists trade batches of kBatch
+// blocks through a shared depot, so blocks freed by one thread (e.g. the
+// tree reset) can be reused by others. Memory is taken from the system in
+// batches and never given back, so once the pool is big enough allocation
+// does not touch the heap.
+template <size_t block_size>
+class BlockPool {
+public:
+  static void* Allocate () {
+    Local& local = GetLocal ();
+    if (local.free_list == NULL) Refill (local);
+    Block* block = local.free_list;
+    local.free_list = block->next;
+    local.count -= 1;
+    return block;
+  }
+
+  static void Free (void* ptr) {
+    Local& local = GetLocal ();
+    if (local.free_list == NULL) Releaser::Touch ();
+    Block* block = static_cast <Block*> (ptr);
+    block->next = local.free_list;
+    local.free_list = block;
+    local.count += 1;
+    if (local.count >= 2 * kBatch) Spill (local);
+  }
+
+  // Memory taken by one block, block_size rounded up for alignment.
+  static size_t BlockBytes () {
+    return sizeof (Block);
+  }
+
+private:
+  static const size_t kBatch = 4096;
+
+  union Block {
+    Block* next;
+    char data [block_size];
+    max_align_t align;
+  };
+
+  struct Batch {
+    Block* head;
+    size_t count;
+  };
+
+  struct Local {
+    Block* free_list;
+    size_t count;
+  };
+
+  struct Depot {
+    std::mutex mutex;
+    std::vector <Batch> batches;
+  };
+
+  // Hands the thread's list to the depot when the thread exits.
+  struct Releaser {
+    ~Releaser () {
+      Local& local = GetLocal ();
+      if (local.free_list == NULL) return;
+      Batch batch = { local.free_list, local.count };
+      local.free_list = NULL;
+      local.count = 0;
+      Depot& depot = GetDepot ();
+      std::lock_guard <std::mutex> lock (depot.mutex);
+      depot.batches.push_back (batch);
+    }
+
+    static void Touch () {
+      static thread_local Releaser releaser;
+      (void) releaser;
+    }
+  };
+
+  // Trivially destructible, so it outlives the Releaser.
+  static Local& GetLocal () {
+    static thread_local Local local = { NULL, 0 };
+    return local;
+  }
+
+  static Depot& GetDepot () {
+    // Never destroyed: blocks may be freed by static destructors.
+    static Depot* depot = new Depot;
+    return *depot;
+  }
+
+  static void Refill (Local& local) {
+    Releaser::Touch ();
+    {
+      Depot& depot = GetDepot ();
+      std::lock_guard <std::mutex> lock (depot.mutex);
+      if (!depot.batches.empty ()) {
+        local.free_list = depot.batches.back ().head;
+        local.count = depot.batches.back ().count;
+        depot.batches.pop_back ();
+        return;
+      }
+    }
+    Block* chunk = static_cast <Block*> (::operator new (kBatch * sizeof (Block)));
+    BlockPoolBytes () += kBatch * sizeof (Block);
+    rep (ii, kBatch) {
+      chunk [ii].next = local.free_list;
+      local.free_list = &chunk [ii];
+    }
+    local.count = kBatch;
+  }
+
+  // Moves kBatch blocks to the depot.
+  static void Spill (Local& local) {
+    Batch batch = { local.free_list, kBatch };
+    Block* last = local.free_list;
+    rep (ii, kBatch - 1) last = last->next;
+    local.free_list = last->next;
+    local.count -= kBatch;
+    last->next = NULL;
+
+    Depot& depot = GetDepot ();
+    std::lock_guard <std::mutex> lock (depot.mutex);
+    depot.batches.push_back (batch);
+  }
+};
+
+
+// STL allocator on top of BlockPool for node based containers
+// (std::list, std::map). Arrays go straight to the heap.
+template <typename T>
+class PoolAllocator {
+public:
+  typedef T value_type;
+  typedef T* pointer;
+  typedef const T* const_pointer;
+  typedef T& reference;
+  typedef const T& const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  template <typename U> struct rebind {
+    typedef PoolAllocator <U> other;
+  };
+
+  PoolAllocator () {
+  }
+
+  template <typename U> PoolAllocator (const PoolAllocator <U>&) {
+  }
+
+  T* allocate (size_t n) {
+    if (n != 1) return static_cast <T*> (::operator new (n * sizeof (T)));
+    return static_cast <T*> (BlockPool <sizeof (T)>::Allocate ());
+  }
+
+  void deallocate (T* ptr, size_t n) {
+    if (n != 1) {
+      ::operator delete (ptr);
+      return;
+    }
+    BlockPool <sizeof (T)>::Free (ptr);
+  }
+
+  template <typename U, typename... Args>
+  void construct (U* ptr, Args&&... args) {
+    ::new (static_cast <void*> (ptr)) U (std::forward <Args> (args)...);
+  }
+
+  template <typename U> void destroy (U* ptr) {
+    ptr->~U ();
+  }
+
+  size_t max_size () const {
+    return size_t (-1) / sizeof (T);
+  }
+
+  template <typename U> bool operator== (const PoolAllocator <U>&) const {
+    return true;
+  }
+
+  template <typename U> bool operator!= (const PoolAllocator <U>&) const {
+    return false;
+  }
+};
+
+#endif
@@ -0,0 +1,169 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "trace.hpp"
+
+namespace Trace {
+
+namespace {
+
+  struct Event {
+    const char* name;
+    uint tid;
+    uint64 begin_ns;
+    uint64 duration_ns;
+    string detail;
+  };
+
+  // Written by its thread, read by WriteJson, hence the mutex.
+  struct Buffer {
+    Buffer () : events (kCapacity), count (0), in_use (true) {}
+
+    mutex buffer_mutex;
+    vector <Event> events;
+    uint64 count;   // events ever added, the ring holds the last kCapacity
+    bool in_use;    // owned by a live thread
+  };
+
+  atomic <bool> enabled (false);
+
+  mutex buffers_mutex;
+  vector <Buffer*> buffers;  // never freed, reused after thread exit
+  uint next_tid = 1;
+
+  uint64 NowNs () {
+    return chrono::duration_cast <chrono::nanoseconds> (
+      chrono::steady_clock::now ().time_since_epoch ()).count ();
+  }
+
+  // Releases the buffer when its thread exits.
+  class ThreadBuffer {
+  public:
+    ThreadBuffer () : buffer (NULL), tid (0) {}
+
+    ~ThreadBuffer () {
+      if (buffer == NULL) return;
+      lock_guard <mutex> lock (buffers_mutex);
+      buffer->in_use = false;
+    }
+
+    Buffer* Get () {
+      if (buffer != NULL) return buffer;
+      lock_guard <mutex> lock (buffers_mutex);
+      tid = next_tid++;
+      rep (ii, buffers.size ()) {
+        if (!buffers [ii]->in_use) {
+          buffer = buffers [ii];
+          buffer->in_use = true;
+          return buffer;
+        }
+      }
+      buffer = new Buffer;
+      buffers.push_back (buffer);
+      return buffer;
+    }
+
+    Buffer* buffer;
+    uint tid;
+  };
+
+  thread_local ThreadBuffer thread_buffer;
+
+  void AddEvent (const char* name, uint64 begin_ns, uint64 end_ns, string& detail) {
+    Buffer* buffer = thread_buffer.Get ();
+    lock_guard <mutex> lock (buffer->buffer_mutex);
+    Event& event = buffer->events [buffer->count % kCapacity];
+    event.name = name;
+    event.tid = thread_buffer.tid;
+    event.begin_ns = begin_ns;
+    event.duration_ns = end_ns - begin_ns;
+    event.detail.swap (detail);
+    buffer->count += 1;
+  }
+
+  void WriteJsonString (ostream& out, const string& s) {
+    out << '"';
+    rep (ii, s.size ()) {
+      char c = s [ii];
+      if (c == '"' || c == '\\') {
+        out << '\\' << c;
+      } else if (uint8_t (c) < 0x20) {
+        out << ' ';
+      } else {
+        out << c;
+      }
+    }
+    out << '"';
+  }
+
+} // namespace
+
+
+void Enable (bool enable) {
+  enabled.store (enable);
+}
+
+
+bool IsEnabled () {
+  return enabled.load (memory_order_relaxed);
+}
+
+
+void Clear () {
+  lock_guard <mutex> lock (buffers_mutex);
+  rep (ii, buffers.size ()) {
+    lock_guard <mutex> buffer_lock (buffers [ii]->buffer_mutex);
+    buffers [ii]->count = 0;
+  }
+}
+
+
+void WriteJson (ostream& out) {
+  lock_guard <mutex> lock (buffers_mutex);
+  out << "{\"traceEvents\": [" << endl;
+  bool first = true;
+  rep (ii, buffers.size ()) {
+    Buffer& buffer = *buffers [ii];
+    lock_guard <mutex> buffer_lock (buffer.buffer_mutex);
+    uint64 begin = buffer.count > kCapacity ? buffer.count - kCapacity : 0;
+    for (uint64 jj = begin; jj < buffer.count; jj++) {
+      const Event& event = buffer.events [jj % kCapacity];
+      out << (first ? "" : ",\n") << "{\"name\": ";
+      WriteJsonString (out, event.name);
+      out << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << event.tid
+          << ", \"ts\": " << event.begin_ns / 1000
+          << "." << (event.begin_ns / 100) % 10
+          << ", \"dur\": " << event.duration_ns / 1000
+          << "." << (event.duration_ns / 100) % 10;
+      if (event.detail != "") {
+        out << ", \"args\": {\"detail\": ";
+        WriteJsonString (out, event.detail);
+        out << "}";
+      }
+      out << "}";
+      first = false;
+    }
+  }
+  out << endl << "]}" << endl;
+}
+
+
+Span::Span (const char* span_name) : name (NULL), begin_ns (0) {
+  if (IsEnabled ()) {
+    name = span_name;
+    begin_ns = NowNs ();
+  }
+}
+
+
+Span::~Span () {
+  if (name != NULL) AddEvent (name, begin_ns, NowNs (), detail);
+}
+
+} // namespace Trace
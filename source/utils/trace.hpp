@@ -0,0 +1,58 @@
+//
+// Copyright 2006 and onwards, Lukasz Lew
+//
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <ostream>
+#include <string>
+
+#include "utils.hpp"
+
+// Timeline of engine activity in Chrome trace-event format
+// (chrome://tracing, ui.perfetto.dev).
+//
+// Every thread records spans into its own ring buffer of kCapacity
+// events; the oldest events are overwritten, so memory stays bounded in
+// long sessions. Buffers of finished threads are reused by new ones.
+// When tracing is disabled a span costs one relaxed atomic load.
+namespace Trace {
+
+  const uint kCapacity = 1 << 15; // events per thread
+
+  void Enable (bool enable);
+  bool IsEnabled ();
+
+  // Drops all recorded events.
+  void Clear ();
+
+  // Writes all recorded events as trace-event JSON.
+  void WriteJson (ostream& out);
+
+  // Records a span from construction to destruction.
+  // Name has to be a string literal.
+  class Span {
+  public:
+    explicit Span (const char* name);
+    ~Span ();
+
+    bool IsActive () const { return name != NULL; }
+    void SetDetail (const string& new_detail) { detail = new_detail; }
+
+  private:
+    const char* name;  // NULL when tracing was disabled
+    uint64 begin_ns;
+    string detail;
+  };
+}
+
+#define TRACE_SPAN(name) Trace::Span trace_span__ (name)
+
+// Detail (e.g. a command line) is shown as an argument of the span.
+// It is not evaluated when tracing is disabled.
+#define TRACE_SPAN_DETAIL(name, detail)                         \
+  Trace::Span trace_span__ (name);                              \
+  if (trace_span__.IsActive ()) trace_span__.SetDetail (detail)
+
+#endif